@@ -0,0 +1,322 @@
+#include "global.h"
+#include "message.h"
+#include "ycsb.h"
+#include "ycsb_query.h"
+#include "txn_table.h"
+#include "work_queue.h"
+#include "sim_manager.h"
+#include "pool.h"
+#include "mem_alloc.h"
+#include "crypto.h"
+#include "database.h"
+#include "jemalloc/jemalloc.h"
+
+/*
+    Microbenchmarks for the primitives on the replica hot path. Build with
+    `make bench` and run as a replica, e.g. ./runbench -nid0. Each line gives
+    the time per operation, the operator new calls and bytes per operation,
+    and the bytes per operation taken from jemalloc by mem_allocator.
+*/
+
+// defined in parser.cpp
+void parser(int argc, char *argv[]);
+
+static uint64_t new_cnt = 0;
+static uint64_t new_bytes = 0;
+
+void *operator new(size_t size)
+{
+    new_cnt++;
+    new_bytes += size;
+    void *ptr = malloc(size ? size : 1);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    free(ptr);
+}
+
+// Running count of bytes this thread took from jemalloc, if stats are on.
+static uint64_t *je_allocated = NULL;
+
+static uint64_t je_bytes()
+{
+    return je_allocated ? *je_allocated : 0;
+}
+
+template <typename F>
+void run_bench(const char *name, uint64_t iters, F body)
+{
+    for (uint64_t i = 0; i < iters / 10 + 1; i++)
+        body(i);
+    uint64_t cnt = new_cnt;
+    uint64_t bytes = new_bytes;
+    uint64_t je = je_bytes();
+    uint64_t starttime = get_server_clock();
+    for (uint64_t i = 0; i < iters; i++)
+        body(i);
+    uint64_t time = get_server_clock() - starttime;
+    printf("%-32s %12.1f ns/op %8.2f allocs/op %10.1f B/op %10.1f je_B/op\n", name,
+           (double)time / iters, (double)(new_cnt - cnt) / iters,
+           (double)(new_bytes - bytes) / iters, (double)(je_bytes() - je) / iters);
+    fflush(stdout);
+}
+
+static ClientQueryBatch *make_client_batch()
+{
+    ClientQueryBatch *bmsg = (ClientQueryBatch *)Message::create_message(CL_BATCH);
+    bmsg->init();
+    for (uint64_t i = 0; i < get_batch_size(); i++)
+    {
+        YCSBClientQueryMessage *clqry = (YCSBClientQueryMessage *)Message::create_message(CL_QRY);
+        clqry->requests.init(g_req_per_query);
+        for (uint64_t j = 0; j < g_req_per_query; j++)
+        {
+            ycsb_request *req = (ycsb_request *)mem_allocator.alloc(sizeof(ycsb_request));
+            req->key = rand() % g_synth_table_size;
+            req->value = rand();
+            clqry->requests.add(req);
+        }
+        clqry->return_node = g_node_cnt;
+        clqry->client_startts = get_sys_clock();
+#if SOA_BATCH
+        bmsg->reqs.add(clqry);
+        Message::release_message(clqry);
+#else
+        bmsg->cqrySet.add(clqry);
+#endif
+    }
+    bmsg->return_node = g_node_cnt;
+    return bmsg;
+}
+
+#if CONSENSUS == HOTSTUFF
+// A quorum certificate over batch_hash carrying 2f+1 signature shares.
+static void make_qc(QuorumCertificate &qc, const string &batch_hash)
+{
+    qc.viewNumber = 1;
+    qc.batch_hash = batch_hash;
+    qc.parent_hash = batch_hash;
+#if THRESHOLD_SIGNATURE
+    unsigned char message[32];
+    memcpy(message, get_secp_hash(batch_hash, HOTSTUFF_PREP_MSG).c_str(), 32);
+    for (uint64_t i = 0; i < 2 * g_min_invalid_nodes + 1; i++)
+    {
+        unsigned char key[32];
+        do
+        {
+            for (uint j = 0; j < 32; j++)
+                key[j] = rand() % 255;
+        } while (!secp256k1_ec_seckey_verify(ctx, key));
+        secp256k1_pubkey pub;
+        secp256k1_ec_pubkey_create(ctx, &pub, key);
+        public_keys[i] = pub;
+        secp256k1_ecdsa_signature sig;
+        secp256k1_ecdsa_sign(ctx, &sig, message, key, NULL, NULL);
+        qc.signature_share_map[i] = sig;
+    }
+#endif
+}
+#endif
+
+static void bench_message(const char *name, Message *msg, uint64_t iters)
+{
+    uint64_t size = msg->get_size();
+    char *buf = (char *)malloc(size);
+    string label = string(name) + " copy_to_buf";
+    run_bench(label.c_str(), iters, [&](uint64_t) {
+        msg->copy_to_buf(buf);
+    });
+    label = string(name) + " copy_from_buf";
+    run_bench(label.c_str(), iters, [&](uint64_t) {
+        Message *copy = Message::create_message(buf);
+        Message::release_message(copy);
+    });
+    printf("%-32s %12lu bytes\n", name, size);
+    free(buf);
+}
+
+int main(int argc, char *argv[])
+{
+    parser(argc, argv);
+    assert(ISSERVER);
+    srand(SEED != 0 ? SEED : get_sys_clock());
+
+    size_t len = sizeof(je_allocated);
+    if (je_mallctl("thread.allocatedp", &je_allocated, &len, NULL, 0) != 0)
+        je_allocated = NULL;
+
+    stats.init(g_total_thread_cnt);
+    simulation = new SimManager;
+    simulation->init();
+#if BANKING_SMART_CONTRACT
+    SCWorkload wl;
+#else
+    YCSBWorkload wl;
+#endif
+    wl.init();
+    work_queue.init();
+    txn_pool.init(&wl, 0);
+    qry_pool.init(&wl, 0);
+    txn_table.init(&wl);
+
+    uint64_t iters = 10000;
+    printf("batch_size=%lu, quorum=%lu\n", get_batch_size(), 2 * g_min_invalid_nodes + 1);
+
+    // Serialization.
+    ClientQueryBatch *bmsg = make_client_batch();
+    bench_message("CL_BATCH", bmsg, iters / 10);
+
+    string batch_hash = calculateHash(bmsg->getString());
+#if CONSENSUS == HOTSTUFF
+    QuorumCertificate qc;
+    make_qc(qc, batch_hash);
+
+    HOTSTUFFGenericMsg *gmsg = (HOTSTUFFGenericMsg *)Message::create_message(HOTSTUFF_GENERIC_MSG);
+    gmsg->view = 1;
+    gmsg->index = 0;
+    gmsg->end_index = get_batch_size() - 1;
+    gmsg->batch_size = get_batch_size();
+    gmsg->hash = batch_hash;
+    gmsg->hashSize = batch_hash.length();
+    gmsg->return_node = g_node_id;
+    gmsg->highQC = qc;
+    bench_message("HOTSTUFF_GENERIC_MSG", gmsg, iters);
+
+    HOTSTUFFNewViewMsg *nmsg = (HOTSTUFFNewViewMsg *)Message::create_message(HOTSTUFF_NEW_VIEW_MSG);
+    nmsg->view = 1;
+    nmsg->index = 0;
+    nmsg->end_index = get_batch_size() - 1;
+    nmsg->batch_size = get_batch_size();
+    nmsg->hash = batch_hash;
+    nmsg->hashSize = batch_hash.length();
+    nmsg->return_node = g_node_id;
+    nmsg->highQC = qc;
+    bench_message("HOTSTUFF_NEW_VIEW_MSG", nmsg, iters);
+#endif
+
+    // Crypto.
+    string key = CmacGenerateHexKey(16);
+    run_bench("getString+CmacSignString", iters / 10, [&](uint64_t) {
+        string s = bmsg->getString();
+        string mac = CmacSignString(key, s);
+    });
+    string batch_str = bmsg->getString();
+#if CRYPTO_METHOD_ED25519
+    ED25519GenerateKeys(g_priv_key, g_public_key);
+    byte bKey[CryptoPP::ed25519PrivateKey::PUBLIC_KEYLENGTH];
+    copyStringToByte(bKey, g_public_key);
+    verifier[g_node_id] = CryptoPP::ed25519::Verifier(bKey);
+    string ed_sig = ED25519signString(batch_str);
+    run_bench("ED25519verifyString", iters / 10, [&](uint64_t) {
+        ED25519verifyString(batch_str, ed_sig, g_node_id);
+    });
+#endif
+    run_bench("calculateHash", iters / 10, [&](uint64_t) {
+        string h = calculateHash(batch_str);
+    });
+#if BINARY_DIGEST
+    run_bench("BatchDigest", iters / 10, [&](uint64_t) {
+        BatchDigest digest;
+        for (uint64_t i = 0; i < get_batch_size(); i++)
+        {
+#if SOA_BATCH
+            digest.add(bmsg->reqs, i);
+#else
+            digest.add(bmsg->cqrySet[i]);
+#endif
+        }
+        string h = digest.get_hash();
+    });
+#if MERKLE_DIGEST
+    BatchDigest tree;
+    for (uint64_t i = 0; i < get_batch_size(); i++)
+    {
+#if SOA_BATCH
+        tree.add(bmsg->reqs, i);
+#else
+        tree.add(bmsg->cqrySet[i]);
+#endif
+    }
+    string root = tree.get_hash();
+    // Leaf hash of the last query, rebuilt by a single-query digest.
+    uint64_t last = get_batch_size() - 1;
+    BatchDigest one;
+#if SOA_BATCH
+    one.add(bmsg->reqs, last);
+#else
+    one.add(bmsg->cqrySet[last]);
+#endif
+    string leaf = one.get_hash();
+    bool proved = true;
+    run_bench("BatchDigest get_proof+verify_proof", iters / 10, [&](uint64_t) {
+        vector<string> proof = tree.get_proof(last);
+        proved &= BatchDigest::verify_proof(leaf, last, get_batch_size(), proof, root);
+    });
+    assert(proved);
+    (void)proved;
+#endif
+#endif
+#if CONSENSUS == HOTSTUFF && THRESHOLD_SIGNATURE
+    bool verified = true;
+    run_bench("ThresholdSignatureVerify", iters / 100, [&](uint64_t) {
+        verified &= qc.ThresholdSignatureVerify(HOTSTUFF_PREP_MSG);
+    });
+    assert(verified);
+#endif
+
+    // Queues.
+#if CONSENSUS == HOTSTUFF
+    gmsg->instance_id = 0;
+    run_bench("QWorkQueue enqueue+dequeue", iters, [&](uint64_t) {
+        work_queue.enqueue(0, gmsg, false);
+        Message *msg = work_queue.dequeue(0);
+        assert(msg == gmsg);
+        (void)msg;
+    });
+#endif
+
+    // Transaction table, with a window of live transactions as under load.
+    uint64_t live = 4 * get_batch_size();
+    for (uint64_t i = 0; i < live; i++)
+        txn_table.get_transaction_manager(0, i, 0);
+    run_bench("TxnTable lookup", iters, [&](uint64_t i) {
+        txn_table.get_transaction_manager(0, i % live, 0);
+    });
+
+    // Storage.
+    DataBase *dbs[] = {new InMemoryDB(), new SQLite()};
+    for (DataBase *sdb : dbs)
+    {
+        sdb->Open("bench-" + to_string(g_node_id));
+        string label = sdb->dbInstance() + " Put";
+        run_bench(label.c_str(), iters, [&](uint64_t i) {
+            sdb->Put(to_string(i % g_synth_table_size), to_string(i));
+        });
+        label = sdb->dbInstance() + " Get";
+        run_bench(label.c_str(), iters, [&](uint64_t i) {
+            string v = sdb->Get(to_string(i % iters));
+        });
+        sdb->Close("bench-" + to_string(g_node_id));
+    }
+
+    Message::release_message(bmsg);
+#if CONSENSUS == HOTSTUFF
+    Message::release_message(gmsg);
+    Message::release_message(nmsg);
+#endif
+    return 0;
+}
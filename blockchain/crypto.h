@@ -119,13 +119,20 @@ inline string ED25519signString(const string message)
     return signature;
 }
 
+// Like ED25519verifyString, but for input that may be forged: no assert.
+inline bool ED25519checkString(const string &message, const string &signature, const uint64_t receiver_node_id)
+{
+    // Checked against the node's verifier in place: no copy of its key, and no
+    // filter chain over a concatenated signature and message.
+    const ed25519::Verifier &thisVerifier = verifier[receiver_node_id];
+    return signature.size() == 64 &&
+           thisVerifier.VerifyMessage((const byte *)message.data(), message.size(),
+                                      (const byte *)signature.data(), signature.size());
+}
+
 inline bool ED25519verifyString(const string message, const string signature, const uint64_t receiver_node_id)
 {
-    bool valid = true;
-    ed25519::Verifier thisVerifier = verifier[receiver_node_id];
-    CryptoPP::StringSource(signature + message, true,
-                           new CryptoPP::SignatureVerificationFilter(thisVerifier,
-                                                                     new CryptoPP::ArraySink((byte *)&valid, sizeof(valid))));
+    bool valid = ED25519checkString(message, signature, receiver_node_id);
     if (valid == false)
     {
         assert(0);
@@ -271,6 +271,92 @@
 #define SYNC_DEBUG false
 #define PVP_FORCE true
 #define MAC_SYNC true
+// Coalescing votes to the same replica across instances under one MAC per frame
+#define VOTE_BUNDLE (false && MAC_SYNC)
+#define VOTE_BUNDLE_WAIT 100000 // in ns
+#define VOTE_BUNDLE_FLAG (1u << 31)
+// Flushing mbufs by bytes and age, adapting to the send rate per destination
+#define ADAPTIVE_FLUSH false
+#define MBUF_FLUSH_BYTES 65536
+#define MBUF_MAX_AGE 500000 // in ns
+#define MBUF_MIN_HOLD 20000 // in ns
+#define MBUF_GAP_ALPHA 0.125
+// Sending large broadcasts as gathered pieces instead of copying them into mbufs
+#define SG_SEND false
+#define SG_SEND_THRESHOLD 16384
+#define SG_HEAD_MAX 4096
+// Parking frames for slow peers instead of spinning on their sockets
+#define SEND_BACKPRESSURE false
+#define PEER_SENDQ_LEN 1024 // frames parked for a peer before it is given up on
+#define PEER_RETRY_WAIT 50000 // in ns
+// Disseminating proposals over a k-ary tree of replicas rooted at the leader
+#define TREE_DISSEMINATION (false && SEPARATE)
+#define TREE_FANOUT 4
+// Disseminating proposals as erasure-coded chunks, any f+1 of which rebuild it
+#define EC_DISSEMINATION (false && SEPARATE)
+#define EC_SET_WINDOW 1024 // batches behind the newest one whose chunks are kept
+// Varint wire format for message headers and the HotStuff consensus messages
+#define COMPACT_WIRE false
+#define COMPACT_WIRE_VERSION 1
+#define COMPACT_WIRE_STATS false // keep the latency stats in compact headers
+// Shared-memory rings instead of sockets between nodes listed with the same address
+#define SHM_TRANSPORT false
+#define SHM_RING_SIZE 4194304 // bytes per ring, a power of two
+// Raw TCP driven by io_uring instead of nng sockets (needs Linux 6.0)
+#define IO_URING_TRANSPORT false
+#define URING_DEPTH 1024
+#define URING_RECV_BUF 65536 // bytes per buffer provided for receives
+#define URING_RECV_BUF_CNT 256 // buffers provided per input thread
+#define URING_WAIT 100000 // in ns, longest sleep of an idle input or output thread
+#define URING_FRAME_MAX (MSG_SIZE_MAX * MESSAGE_PER_BUFFER) // longer frames drop the connection
+// Moving replica receive sockets between input threads by measured load
+#define REBALANCE_INPUT (false && !INPUT_OP)
+#define REBALANCE_PERIOD 1000000000 // in ns
+#define REBALANCE_GAP 0.2 // least gap between busiest and idlest thread, relative to the busiest
+#define REBALANCE_MOVES 2 // sockets moved per period at most
+// Starting once a quorum of replicas is up; frames to peers still connecting are parked
+#define QUORUM_START false
+#define QUORUM_PARK_LEN 16384 // frames held per unconnected peer before it is given up on
+#define REDIAL_MIN_MS 10
+#define REDIAL_MAX_MS 1000
+// Per-peer transport counters kept per thread, with an RTT estimate from echoed frame stamps
+#define LINK_STATS false
+// Most pieces a frame is gathered from, plus the stamp
+#define LINK_IOV_MAX 8
+// LZ compression of frame bodies of at least COMPRESS_MIN_SIZE bytes
+#define WIRE_COMPRESS false
+#define COMPRESS_MIN_SIZE 4096
+#define COMPRESS_FLAG (1u << 30)
+#define COMPRESS_MAX_FRAME (64 * MSG_SIZE_MAX) // largest body a frame may inflate to
+// Recording received frames to RDB_RECORD_DIR, or feeding a replica the frames
+// in RDB_REPLAY_DIR instead of the network (paced if RDB_REPLAY_PACED is set)
+#define RECORD_REPLAY false
+// Per-thread slabs for mem_alloc requests of up to 512 bytes, with frees from
+// other threads handed back to the owner in batches
+#define SLAB_ALLOC false
+#define SLAB_REGION_SIZE (1UL << 36) // address space reserved for all slabs
+#define SLAB_SIZE 65536
+#define SLAB_REMOTE_BATCH 64
+// Client requests of a batch kept column by column (keys, values, timestamps,
+// clients) in ClientQueryBatch and HotStuff proposals
+#define SOA_BATCH (false && CONSENSUS == HOTSTUFF && CHAINED && SEPARATE && !BANKING_SMART_CONTRACT)
+// Batch digests over the binary encoding of the requests, streamed into
+// SHA-256, instead of over their concatenated getString()
+#define BINARY_DIGEST (false && !BANKING_SMART_CONTRACT)
+// Batch digest as the root of a Merkle tree over the queries. Leaves of
+// batches of MERKLE_PARALLEL_MIN or more are shared with MERKLE_THREADS - 1
+// helper threads, started once per process
+#define MERKLE_DIGEST (false && BINARY_DIGEST)
+#define MERKLE_THREADS 4
+#define MERKLE_PARALLEL_MIN 512
+// Transparent huge pages for jemalloc and the slab region; with
+// HUGE_PAGES_EXPLICIT the pre-faulted slabs come from vm.nr_hugepages instead
+#define HUGE_PAGES false
+#define HUGE_PAGES_EXPLICIT false
+// Pools filled and slab memory faulted in at startup, so runs start warm
+#define PREFAULT false
+#define PREFAULT_POOL_CNT (4 * BATCH_SIZE) // objects in each pool queue
+#define PREFAULT_SLAB_SIZE (1UL << 30)     // bytes of the slab region
 #define SYNC_QC true
 #define SEPARATE true
 #define ROUNDS_IN_ADVANCE 0
@@ -1,3 +1,4 @@
+#include "global.h"
 #include "database.h"
 #include <unordered_map>
 #include <iostream>
@@ -11,6 +12,10 @@ int InMemoryDB::Open(const std::string)
 {
     db = new std::unordered_map<std::string, dbTable>();
     activeTable = "table1";
+#if PREFAULT
+    // Buckets for the whole key space, so the table never rehashes mid run.
+    (*db)[activeTable].reserve(g_synth_table_size);
+#endif
 
     std::cout << std::endl
               << "In-Memory DB configuration OK" << std::endl;
@@ -0,0 +1,64 @@
+#!/bin/bash
+# Runs a whole cluster on this machine: NODE_CNT replicas and CLIENT_NODE_CNT
+# clients as set in config.h, talking over loopback sockets. Build with a
+# non-zero SEED for repeatable runs.
+#
+# This starts one rundb/runcl process per node over the real transport; it is
+# not a single-binary harness with an in-memory Transport.
+#
+# Usage: scripts/local_cluster.sh [tag] [extra rundb/runcl args, e.g. -done30]
+# Outputs go to results/local_<tag>_node<i>.out.
+
+cd "$(dirname "$0")/.." || exit 1
+
+tag=${1:-run}
+shift 2>/dev/null
+extra="$*"
+
+cfg() {
+	grep -o -P "^#define $1 \K\S+" config.h
+}
+snodes=$(cfg NODE_CNT)
+cnodes=$(cfg CLIENT_NODE_CNT)
+if [ ! -x ./rundb ] || [ ! -x ./runcl ]; then
+	echo "Build rundb and runcl first"
+	exit 1
+fi
+
+# Nodes read ifconfig.txt from SCHEMA_PATH, so the one in the tree is kept.
+schema=$(mktemp -d)
+for i in $(seq 1 $((snodes + cnodes))); do
+	echo "127.0.0.1"
+done >"${schema}/ifconfig.txt"
+
+pids=()
+cleanup() {
+	for pid in "${pids[@]}"; do
+		kill "${pid}" 2>/dev/null
+	done
+	rm -rf "${schema}"
+}
+trap cleanup EXIT INT TERM
+
+mkdir -p results
+for i in $(seq 0 $((snodes - 1))); do
+	SCHEMA_PATH="${schema}/" ./rundb -nid${i} ${extra} >results/local_${tag}_node${i}.out 2>&1 &
+	pids+=($!)
+done
+for i in $(seq ${snodes} $((snodes + cnodes - 1))); do
+	SCHEMA_PATH="${schema}/" ./runcl -nid${i} ${extra} >results/local_${tag}_node${i}.out 2>&1 &
+	pids+=($!)
+done
+echo "Started ${snodes} replicas and ${cnodes} clients"
+wait "${pids[@]}"
+
+echo "Throughputs:"
+for i in $(seq 0 $((snodes + cnodes - 1))); do
+	temp=$(grep -o -P 'tput=\K\d+' results/local_${tag}_node${i}.out | tail -1)
+	echo "${i}: ${temp}"
+done
+echo "Latencies:"
+for i in $(seq ${snodes} $((snodes + cnodes - 1))); do
+	temp=$(grep -o -P 'AVG: \K\d+\.\d+' results/local_${tag}_node${i}.out | tail -1)
+	echo "latency ${i}: ${temp}"
+done
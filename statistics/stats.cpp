@@ -21,6 +21,9 @@ void Stats_thd::init(uint64_t thd_id)
 #if TIME_PROF_ENABLE
     io_thread_idle_time = (double *)mem_allocator.align_alloc(sizeof(double) * (g_send_thread_cnt + g_rem_thread_cnt));
 #endif
+#if LINK_STATS
+    links = (LinkStats *)mem_allocator.align_alloc(sizeof(LinkStats) * g_total_node_cnt);
+#endif
 
     client_client_latency.init(g_max_txn_per_part, ArrIncr);
     clear();
@@ -36,6 +39,9 @@ void Stats_thd::free()
 #if TIME_PROF_ENABLE
     mem_allocator.free(io_thread_idle_time, 0);
 #endif
+#if LINK_STATS
+    mem_allocator.free(links, 0);
+#endif
 
     client_client_latency.free();
     //last_start_commit_latency.free();
@@ -147,9 +153,19 @@ void Stats_thd::clear()
     msg_batch_size_bytes_to_server = 0;
     msg_batch_size_bytes_to_client = 0;
     msg_send_cnt = 0;
+    msg_send_parked_cnt = 0;
+    msg_uring_enter_cnt = 0;
+    msg_send_dropped_cnt = 0;
+    msg_compress_cnt = 0;
+    msg_compress_skip_cnt = 0;
+    msg_compress_raw_bytes = 0;
+    msg_compress_wire_bytes = 0;
+    msg_compress_time = 0;
+    msg_decompress_time = 0;
     msg_recv_cnt = 0;
     msg_unpack_time = 0;
     mbuf_send_intv_time = 0;
+    mbuf_wait_time = 0;
     msg_copy_output_time = 0;
 #if TIME_PROF_ENABLE
     for (uint64_t i = 0; i < (g_send_thread_cnt + g_rem_thread_cnt); ++i)
@@ -157,6 +173,13 @@ void Stats_thd::clear()
         io_thread_idle_time[i] = 0;
     }
 #endif
+#if LINK_STATS
+    memset(links, 0, sizeof(LinkStats) * g_total_node_cnt);
+    for (uint64_t i = 0; i < g_total_node_cnt; ++i)
+    {
+        links[i].rtt_min = UINT64_MAX;
+    }
+#endif
 
     // Transaction Table
     txn_table_new_cnt = 0;
@@ -267,6 +290,7 @@ void Stats_thd::print_client(FILE *outf, bool prog)
             total_runtime / BILLION, tput, txn_cnt, txn_sent_cnt, txn_run_time / BILLION, cross_txn_run_time / BILLION, txn_run_avg_time / BILLION, cl_send_intv / BILLION);
     // IO
     double mbuf_send_intv_time_avg = 0;
+    double mbuf_wait_time_avg = 0;
     double msg_unpack_time_avg = 0;
     double msg_send_time_avg = 0;
     double msg_recv_time_avg = 0;
@@ -281,6 +305,8 @@ void Stats_thd::print_client(FILE *outf, bool prog)
         msg_batch_size_msgs_avg = msg_batch_size_msgs / msg_batch_cnt;
         msg_batch_size_bytes_avg = msg_batch_size_bytes / msg_batch_cnt;
     }
+    if (msg_batch_size_msgs > 0)
+        mbuf_wait_time_avg = mbuf_wait_time / msg_batch_size_msgs;
     if (msg_recv_cnt > 0)
     {
         msg_recv_time_avg = msg_recv_time / msg_recv_cnt;
@@ -290,6 +316,9 @@ void Stats_thd::print_client(FILE *outf, bool prog)
     {
         msg_send_time_avg = msg_send_time / msg_send_cnt;
     }
+    double msg_compress_ratio = 0;
+    if (msg_compress_wire_bytes > 0)
+        msg_compress_ratio = (double)msg_compress_raw_bytes / msg_compress_wire_bytes;
     fprintf(outf,
             "\nmsg_queue_delay_time=%f"
             "\nmsg_queue_cnt=%ld"
@@ -308,13 +337,25 @@ void Stats_thd::print_client(FILE *outf, bool prog)
             "\nmsg_batch_size_bytes_to_server=%ld"
             "\nmsg_batch_size_bytes_to_client=%ld"
             "\nmsg_send_cnt=%ld"
+            "\nmsg_send_parked_cnt=%ld"
+            "\nmsg_uring_enter_cnt=%ld"
+            "\nmsg_send_dropped_cnt=%ld"
+            "\nmsg_compress_cnt=%ld"
+            "\nmsg_compress_skip_cnt=%ld"
+            "\nmsg_compress_raw_bytes=%ld"
+            "\nmsg_compress_wire_bytes=%ld"
+            "\nmsg_compress_ratio=%f"
+            "\nmsg_compress_time=%f"
+            "\nmsg_decompress_time=%f"
             "\nmsg_recv_cnt=%ld"
             "\nmsg_unpack_time=%f"
             "\nmsg_unpack_time_avg=%f"
             "\nmbuf_send_intv_time=%f"
             "\nmbuf_send_intv_time_avg=%f"
+            "\nmbuf_wait_time=%f"
+            "\nmbuf_wait_time_avg=%f"
             "\nmsg_copy_output_time=%f",
-            msg_queue_delay_time / BILLION, msg_queue_cnt, msg_queue_enq_cnt, msg_queue_delay_time_avg / BILLION, msg_send_time / BILLION, msg_send_time_avg / BILLION, msg_recv_time / BILLION, msg_recv_time_avg / BILLION, msg_recv_idle_time / BILLION, msg_batch_cnt, msg_batch_size_msgs, msg_batch_size_msgs_avg, msg_batch_size_bytes, msg_batch_size_bytes_avg, msg_batch_size_bytes_to_server, msg_batch_size_bytes_to_client, msg_send_cnt, msg_recv_cnt, msg_unpack_time / BILLION, msg_unpack_time_avg / BILLION, mbuf_send_intv_time / BILLION, mbuf_send_intv_time_avg / BILLION, msg_copy_output_time / BILLION);
+            msg_queue_delay_time / BILLION, msg_queue_cnt, msg_queue_enq_cnt, msg_queue_delay_time_avg / BILLION, msg_send_time / BILLION, msg_send_time_avg / BILLION, msg_recv_time / BILLION, msg_recv_time_avg / BILLION, msg_recv_idle_time / BILLION, msg_batch_cnt, msg_batch_size_msgs, msg_batch_size_msgs_avg, msg_batch_size_bytes, msg_batch_size_bytes_avg, msg_batch_size_bytes_to_server, msg_batch_size_bytes_to_client, msg_send_cnt, msg_send_parked_cnt, msg_uring_enter_cnt, msg_send_dropped_cnt, msg_compress_cnt, msg_compress_skip_cnt, msg_compress_raw_bytes, msg_compress_wire_bytes, msg_compress_ratio, msg_compress_time / BILLION, msg_decompress_time / BILLION, msg_recv_cnt, msg_unpack_time / BILLION, msg_unpack_time_avg / BILLION, mbuf_send_intv_time / BILLION, mbuf_send_intv_time_avg / BILLION, mbuf_wait_time / BILLION, mbuf_wait_time_avg / BILLION, msg_copy_output_time / BILLION);
 
 #if TIME_PROF_ENABLE
     for (uint64_t i = 0; i < (g_rem_thread_cnt + g_send_thread_cnt); ++i)
@@ -455,9 +496,19 @@ void Stats_thd::combine(Stats_thd *stats)
     msg_batch_size_bytes_to_server += stats->msg_batch_size_bytes_to_server;
     msg_batch_size_bytes_to_client += stats->msg_batch_size_bytes_to_client;
     msg_send_cnt += stats->msg_send_cnt;
+    msg_send_parked_cnt += stats->msg_send_parked_cnt;
+    msg_uring_enter_cnt += stats->msg_uring_enter_cnt;
+    msg_send_dropped_cnt += stats->msg_send_dropped_cnt;
+    msg_compress_cnt += stats->msg_compress_cnt;
+    msg_compress_skip_cnt += stats->msg_compress_skip_cnt;
+    msg_compress_raw_bytes += stats->msg_compress_raw_bytes;
+    msg_compress_wire_bytes += stats->msg_compress_wire_bytes;
+    msg_compress_time += stats->msg_compress_time;
+    msg_decompress_time += stats->msg_decompress_time;
     msg_recv_cnt += stats->msg_recv_cnt;
     msg_unpack_time += stats->msg_unpack_time;
     mbuf_send_intv_time += stats->mbuf_send_intv_time;
+    mbuf_wait_time += stats->mbuf_wait_time;
     msg_copy_output_time += stats->msg_copy_output_time;
 
 #if TIME_PROF_ENABLE
@@ -466,6 +517,25 @@ void Stats_thd::combine(Stats_thd *stats)
         io_thread_idle_time[i] += stats->io_thread_idle_time[i];
     }
 #endif
+#if LINK_STATS
+    for (uint64_t i = 0; i < g_total_node_cnt; ++i)
+    {
+        LinkStats &l = links[i];
+        LinkStats &o = stats->links[i];
+        l.bytes_sent += o.bytes_sent;
+        l.bytes_recv += o.bytes_recv;
+        l.frames_sent += o.frames_sent;
+        l.frames_recv += o.frames_recv;
+        l.msgs_sent += o.msgs_sent;
+        l.msgs_recv += o.msgs_recv;
+        l.sendq_max = max(l.sendq_max, o.sendq_max);
+        l.sendq_sum += o.sendq_sum;
+        l.send_blocked_time += o.send_blocked_time;
+        l.rtt_sum += o.rtt_sum;
+        l.rtt_cnt += o.rtt_cnt;
+        l.rtt_min = min(l.rtt_min, o.rtt_min);
+    }
+#endif
 
     // Concurrency control, general
     //cc_conflict_cnt+=stats->cc_conflict_cnt;
@@ -597,6 +667,12 @@ void Stats::print_client(bool prog)
     totals->print_client(outf, prog);
     mem_util(outf);
     cpu_util(outf);
+#if LINK_STATS
+    print_links(outf);
+#endif
+#if SLAB_ALLOC
+    mem_allocator.print_slabs(outf);
+#endif
     double tput = 0;
     double c_tput = 0;
     if (totals->total_runtime > 0)
@@ -660,6 +736,12 @@ void Stats::print(bool prog)
         mem_util(outf);
         cpu_util(outf);
         print_msg_sizes(outf);
+#if LINK_STATS
+        print_links(outf);
+#endif
+#if SLAB_ALLOC
+        mem_allocator.print_slabs(outf);
+#endif
     }
 
     double tput = 0, c_tput = 0, interval_tput = 0, interval_c_tput = 0;
@@ -932,6 +1014,12 @@ void Stats_thd::print(FILE *outf, bool prog)
     {
         msg_send_time_avg = msg_send_time / msg_send_cnt;
     }
+    double msg_compress_ratio = 0;
+    if (msg_compress_wire_bytes > 0)
+        msg_compress_ratio = (double)msg_compress_raw_bytes / msg_compress_wire_bytes;
+    double mbuf_wait_time_avg = 0;
+    if (msg_batch_size_msgs > 0)
+        mbuf_wait_time_avg = mbuf_wait_time / msg_batch_size_msgs;
     fprintf(outf,
             // "msg_queue_delay_time=%f\n"
             // "msg_queue_cnt=%ld\n"
@@ -943,13 +1031,25 @@ void Stats_thd::print(FILE *outf, bool prog)
             "msg_recv_time_avg=%f\n"
             "msg_recv_idle_time=%f\n"
             "msg_send_cnt=%ld\n"
+            "msg_send_parked_cnt=%ld\n"
+            "msg_uring_enter_cnt=%ld\n"
+            "msg_send_dropped_cnt=%ld\n"
             "msg_recv_cnt=%ld\n"
+            "msg_compress_cnt=%ld\n"
+            "msg_compress_skip_cnt=%ld\n"
+            "msg_compress_raw_bytes=%ld\n"
+            "msg_compress_wire_bytes=%ld\n"
+            "msg_compress_ratio=%f\n"
+            "msg_compress_time=%f\n"
+            "msg_decompress_time=%f\n"
+            "mbuf_wait_time=%f\n"
+            "mbuf_wait_time_avg=%f\n"
             // ,msg_queue_delay_time / BILLION
             // ,msg_queue_cnt
             // ,msg_queue_enq_cnt
             // ,msg_queue_delay_time_avg / BILLION
             ,
-            msg_send_time / BILLION, msg_send_time_avg / BILLION, msg_recv_time / BILLION, msg_recv_time_avg / BILLION, msg_recv_idle_time / BILLION, msg_send_cnt, msg_recv_cnt);
+            msg_send_time / BILLION, msg_send_time_avg / BILLION, msg_recv_time / BILLION, msg_recv_time_avg / BILLION, msg_recv_idle_time / BILLION, msg_send_cnt, msg_send_parked_cnt, msg_uring_enter_cnt, msg_send_dropped_cnt, msg_recv_cnt, msg_compress_cnt, msg_compress_skip_cnt, msg_compress_raw_bytes, msg_compress_wire_bytes, msg_compress_ratio, msg_compress_time / BILLION, msg_decompress_time / BILLION, mbuf_wait_time / BILLION, mbuf_wait_time_avg / BILLION);
 
 #if TIME_PROF_ENABLE
     for (uint64_t i = 0; i < (g_rem_thread_cnt + g_send_thread_cnt); ++i)
@@ -1021,6 +1121,26 @@ void Stats::set_message_size(uint64_t rtype, uint64_t size)
         break;
     }
 }
+#if LINK_STATS
+// One line per peer this node exchanged frames with, merged over all threads.
+void Stats::print_links(FILE *outf)
+{
+    for (uint64_t i = 0; i < g_total_node_cnt; i++)
+    {
+        LinkStats &l = totals->links[i];
+        if (l.frames_sent == 0 && l.frames_recv == 0)
+            continue;
+        fprintf(outf,
+                "\nlink_%ld: bytes_sent=%ld bytes_recv=%ld frames_sent=%ld frames_recv=%ld"
+                " msgs_sent=%ld msgs_recv=%ld sendq_max=%ld sendq_avg=%f send_blocked_time=%f"
+                " rtt_avg=%f rtt_min=%f rtt_cnt=%ld",
+                i, l.bytes_sent, l.bytes_recv, l.frames_sent, l.frames_recv,
+                l.msgs_sent, l.msgs_recv, l.sendq_max, l.frames_sent ? (double)l.sendq_sum / l.frames_sent : 0.0, l.send_blocked_time / BILLION,
+                l.rtt_cnt ? l.rtt_sum / l.rtt_cnt / BILLION : 0.0, l.rtt_cnt ? (double)l.rtt_min / BILLION : 0.0, l.rtt_cnt);
+    }
+}
+#endif
+
 void Stats::print_msg_sizes(FILE *outf)
 {
     fprintf(outf,
@@ -21,6 +21,30 @@ private:
     double value;
 };
 
+#if LINK_STATS
+// Transport counters of one peer, as seen by one thread.
+struct LinkStats
+{
+    uint64_t bytes_sent;
+    uint64_t bytes_recv;
+    uint64_t frames_sent;
+    uint64_t frames_recv;
+    uint64_t msgs_sent;
+    uint64_t msgs_recv;
+    uint64_t sendq_max;
+    uint64_t sendq_sum; // Frames queued ahead, summed over frames sent
+    double send_blocked_time;
+    double rtt_sum;
+    uint64_t rtt_cnt;
+    uint64_t rtt_min;
+};
+#define INC_LINK_STATS(tid, node, name, value)        \
+    if (STATS_ENABLE && simulation->is_warmup_done()) \
+        stats._stats[tid]->links[node].name += value;
+#else
+#define INC_LINK_STATS(tid, node, name, value)
+#endif
+
 class Stats_thd
 {
 public:
@@ -35,6 +59,9 @@ public:
 
     uint64_t *part_cnt;
     uint64_t *part_acc;
+#if LINK_STATS
+    LinkStats *links; // Indexed by node id
+#endif
 
     double total_runtime;
 
@@ -124,9 +151,19 @@ public:
     uint64_t msg_batch_size_bytes_to_server;
     uint64_t msg_batch_size_bytes_to_client;
     uint64_t msg_send_cnt;
+    uint64_t msg_send_parked_cnt;
+    uint64_t msg_uring_enter_cnt;
+    uint64_t msg_send_dropped_cnt;
+    uint64_t msg_compress_cnt;
+    uint64_t msg_compress_skip_cnt; // Frames that did not shrink
+    uint64_t msg_compress_raw_bytes;
+    uint64_t msg_compress_wire_bytes;
+    double msg_compress_time;
+    double msg_decompress_time;
     uint64_t msg_recv_cnt;
     double msg_unpack_time;
     double mbuf_send_intv_time;
+    double mbuf_wait_time;
     double msg_copy_output_time;
 
 #if TIME_PROF_ENABLE
@@ -244,6 +281,9 @@ public:
     void cpu_util(FILE *outf);
     void print_prof(FILE *outf);
     void print_msg_sizes(FILE *outf);
+#if LINK_STATS
+    void print_links(FILE *outf);
+#endif
     void set_message_size(uint64_t rtype, uint64_t size);
 
     clock_t lastCPU, lastSysCPU, lastUserCPU;
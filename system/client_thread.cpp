@@ -240,7 +240,12 @@ RC ClientThread::run()
 
 #endif
 
+#if SOA_BATCH
+		bmsg->reqs.add(clqry);
+		Message::release_message(clqry);
+#else
 		bmsg->cqrySet.add(clqry);
+#endif
 		addMore++;
 		// Resetting and sending the message
 		if (addMore == g_batch_size)
@@ -289,7 +294,11 @@ RC ClientThread::run()
 			ClientQueryBatch *deepCqry = (ClientQueryBatch *)deepCMsg;
 			uint64_t c_txn_id = get_sys_clock();
 			deepCqry->txn_id = c_txn_id;
+#if SOA_BATCH
+			client_timer->startTimer(deepCqry->reqs.client_ts[get_batch_size() - 1], deepCqry);
+#else
 			client_timer->startTimer(deepCqry->cqrySet[get_batch_size() - 1]->client_startts, deepCqry);
+#endif
 			delete_msg_buffer(buf);
 #endif // TIMER_ON
 
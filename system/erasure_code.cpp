@@ -0,0 +1,359 @@
+#include "erasure_code.h"
+#include "message.h"
+#include "msg_queue.h"
+
+#if EC_DISSEMINATION
+
+ChunkStore chunk_store;
+
+// Log and exponent tables of GF(2^8) with the polynomial 0x11d.
+struct GFTables
+{
+    uint8_t exp[512];
+    uint8_t log[256];
+    GFTables()
+    {
+        uint32_t x = 1;
+        for (uint32_t i = 0; i < 255; i++)
+        {
+            exp[i] = x;
+            log[x] = i;
+            x <<= 1;
+            if (x & 0x100)
+                x ^= 0x11d;
+        }
+        for (uint32_t i = 255; i < 512; i++)
+            exp[i] = exp[i - 255];
+        log[0] = 0;
+    }
+};
+static GFTables gf;
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    if (a == 0 || b == 0)
+        return 0;
+    return gf.exp[gf.log[a] + gf.log[b]];
+}
+
+static inline uint8_t gf_inv(uint8_t a)
+{
+    assert(a != 0);
+    return gf.exp[255 - gf.log[a]];
+}
+
+// Coefficient of data chunk i in parity chunk j (j >= k > i).
+static inline uint8_t cauchy(uint64_t j, uint64_t i)
+{
+    return gf_inv((uint8_t)(j ^ i));
+}
+
+// out ^= coef * in, using a product table for the coefficient.
+static void gf_mul_add(uint8_t *out, const uint8_t *in, uint8_t coef, uint64_t len)
+{
+    if (coef == 0)
+        return;
+    uint8_t table[256];
+    for (uint32_t v = 0; v < 256; v++)
+        table[v] = gf_mul(coef, v);
+    for (uint64_t b = 0; b < len; b++)
+        out[b] ^= table[in[b]];
+}
+
+void ec_encode(const char *data, uint64_t size, uint64_t k, uint64_t n, vector<string> &chunks)
+{
+    assert(k > 0 && k <= n && n <= 256);
+    uint64_t csize = (size + k - 1) / k;
+    chunks.assign(n, string(csize, '\0'));
+    for (uint64_t i = 0; i < k && i * csize < size; i++)
+    {
+        uint64_t len = size - i * csize < csize ? size - i * csize : csize;
+        memcpy(&chunks[i][0], data + i * csize, len);
+    }
+    for (uint64_t j = k; j < n; j++)
+    {
+        uint8_t *out = (uint8_t *)&chunks[j][0];
+        for (uint64_t i = 0; i < k; i++)
+            gf_mul_add(out, (const uint8_t *)chunks[i].data(), cauchy(j, i), csize);
+    }
+}
+
+bool ec_decode(const vector<uint64_t> &idx, const vector<string> &chunks, uint64_t k, uint64_t size, string &data)
+{
+    if (idx.size() < k || chunks.size() < k)
+        return false;
+    uint64_t csize = chunks[0].size();
+    if (csize * k < size)
+        return false;
+
+    // Rows of the generator matrix for the chunks at hand, then invert them.
+    vector<vector<uint8_t>> m(k, vector<uint8_t>(k, 0));
+    vector<vector<uint8_t>> inv(k, vector<uint8_t>(k, 0));
+    for (uint64_t r = 0; r < k; r++)
+    {
+        if (chunks[r].size() != csize)
+            return false;
+        if (idx[r] < k)
+            m[r][idx[r]] = 1;
+        else
+            for (uint64_t i = 0; i < k; i++)
+                m[r][i] = cauchy(idx[r], i);
+        inv[r][r] = 1;
+    }
+    for (uint64_t c = 0; c < k; c++)
+    {
+        uint64_t p = c;
+        while (p < k && m[p][c] == 0)
+            p++;
+        if (p == k)
+            return false;
+        swap(m[p], m[c]);
+        swap(inv[p], inv[c]);
+        uint8_t s = gf_inv(m[c][c]);
+        for (uint64_t i = 0; i < k; i++)
+        {
+            m[c][i] = gf_mul(m[c][i], s);
+            inv[c][i] = gf_mul(inv[c][i], s);
+        }
+        for (uint64_t r = 0; r < k; r++)
+        {
+            uint8_t f = m[r][c];
+            if (r == c || f == 0)
+                continue;
+            for (uint64_t i = 0; i < k; i++)
+            {
+                m[r][i] ^= gf_mul(f, m[c][i]);
+                inv[r][i] ^= gf_mul(f, inv[c][i]);
+            }
+        }
+    }
+
+    data.assign(k * csize, '\0');
+    for (uint64_t i = 0; i < k; i++)
+    {
+        uint8_t *out = (uint8_t *)&data[i * csize];
+        for (uint64_t r = 0; r < k; r++)
+            gf_mul_add(out, (const uint8_t *)chunks[r].data(), inv[i][r], csize);
+    }
+    data.resize(size);
+    return true;
+}
+
+void send_proposal_chunks(uint64_t thd_id, HOTSTUFFProposalMsg *prop)
+{
+    uint64_t k = g_min_invalid_nodes + 1;
+    uint64_t size = prop->get_size();
+    char *buf = create_msg_buffer(prop);
+    prop->copy_to_buf(buf);
+    vector<string> chunks;
+    ec_encode(buf, size, k, g_node_cnt, chunks);
+    string data_hash = calculateHash(string(buf, size));
+    delete_msg_buffer(buf);
+
+    string leader_sig;
+    for (uint64_t node_id = 0; node_id < g_node_cnt; node_id++)
+    {
+        if (node_id == g_node_id)
+            continue;
+        HOTSTUFFChunkMsg *cmsg = (HOTSTUFFChunkMsg *)Message::create_message(HOTSTUFF_CHUNK_MSG);
+        cmsg->txn_id = prop->txn_id;
+        cmsg->instance_id = prop->instance_id;
+        cmsg->view = prop->view;
+        cmsg->chunk_idx = node_id;
+        cmsg->data_size = size;
+        cmsg->hash = prop->hash;
+        cmsg->hashSize = prop->hash.size();
+        cmsg->data_hash = data_hash;
+        cmsg->dataHashSize = data_hash.size();
+        // Signed once, as it is the same for every chunk.
+        if (leader_sig.empty())
+        {
+            cmsg->sign_leader();
+            leader_sig = cmsg->leader_sig;
+        }
+        cmsg->leader_sig = leader_sig;
+        cmsg->leaderSigSize = leader_sig.size();
+        cmsg->chunk = chunks[node_id];
+        cmsg->chunkSize = cmsg->chunk.size();
+
+        vector<uint64_t> dest;
+        dest.push_back(node_id);
+        msg_queue.enqueue(thd_id, cmsg, dest);
+    }
+    Message::release_message(prop);
+}
+
+/*
+    A replica only takes the chunk of its own index from the leader, and the
+    chunk of index i only from replica i, which passes on what the leader sent
+    it. Every chunk carries the leader's signature over the digest and size of
+    the serialized proposal, checked before the chunk is kept, and the rebuilt
+    proposal must match that digest. Each index is accepted once per batch and
+    chunks are grouped by the signed digest. Once a group holds f+1 chunks the
+    proposal is rebuilt. If that fails, the oldest chunk of the group is
+    dropped so that the next arrival is decoded with a different set. A
+    rebuilt batch stays as an empty set until swept, so that late chunks
+    cannot start it over.
+*/
+Message *ChunkStore::add(uint64_t thd_id, HOTSTUFFChunkMsg *cmsg)
+{
+#if ENABLE_ENCRYPT
+    if (!cmsg->validate())
+    {
+        Message::release_message(cmsg);
+        return NULL;
+    }
+#endif
+
+    uint64_t leader = get_view_primary(cmsg->view, cmsg->instance_id);
+    bool from_leader = cmsg->return_node_id == leader && cmsg->chunk_idx == g_node_id;
+    if (cmsg->chunk_idx >= g_node_cnt || cmsg->chunk_idx == leader ||
+        (!from_leader && cmsg->chunk_idx != cmsg->return_node_id))
+    {
+        Message::release_message(cmsg);
+        return NULL;
+    }
+
+    pair<uint64_t, uint64_t> key = make_pair(cmsg->txn_id, cmsg->instance_id);
+    string group_key = cmsg->data_hash + "/" + to_string(cmsg->data_size);
+
+    // A signature already checked for this group need not be checked again.
+    bool checked = false;
+    bool drop = false;
+    lock.lock();
+    auto sit = sets.find(key);
+    if (sit != sets.end())
+    {
+        drop = sit->second.done || sit->second.seen[cmsg->chunk_idx];
+        auto git = sit->second.groups.find(group_key);
+        checked = git != sit->second.groups.end() && !git->second.empty() &&
+                  git->second[0]->leader_sig == cmsg->leader_sig;
+    }
+    else
+    {
+        drop = cmsg->txn_id + EC_SET_WINDOW * get_batch_size() < newest_txn;
+    }
+    lock.unlock();
+    if (drop || (!checked && !cmsg->validate_leader(leader)))
+    {
+        Message::release_message(cmsg);
+        return NULL;
+    }
+
+    // This replica's own chunk is passed on to everyone but the leader once
+    // it is accepted.
+    Message *fwd = NULL;
+    if (from_leader)
+    {
+        char *buf = create_msg_buffer(cmsg);
+        fwd = deep_copy_msg(buf, cmsg);
+        delete_msg_buffer(buf);
+    }
+
+    Message *msg = NULL;
+    bool accepted = false;
+    lock.lock();
+    ChunkSet &set = sets[key];
+    if (set.seen.empty())
+        set.seen.assign(g_node_cnt, false);
+    if (set.done || set.seen[cmsg->chunk_idx])
+    {
+        Message::release_message(cmsg);
+    }
+    else
+    {
+        accepted = true;
+        set.seen[cmsg->chunk_idx] = true;
+        vector<HOTSTUFFChunkMsg *> &group = set.groups[group_key];
+        group.push_back(cmsg);
+        if (group.size() >= g_min_invalid_nodes + 1)
+            msg = rebuild(group);
+        if (msg)
+        {
+            msg->return_node_id = leader;
+            set.done = true;
+            release_chunks(set);
+        }
+    }
+    if (key.first > newest_txn)
+    {
+        newest_txn = key.first;
+        sweep(newest_txn);
+    }
+    lock.unlock();
+
+    if (fwd && accepted)
+    {
+        vector<uint64_t> dest;
+        for (uint64_t node_id = 0; node_id < g_node_cnt; node_id++)
+        {
+            if (node_id != g_node_id && node_id != leader)
+                dest.push_back(node_id);
+        }
+        msg_queue.enqueue(thd_id, fwd, dest);
+    }
+    else if (fwd)
+    {
+        Message::release_message(fwd);
+    }
+    return msg;
+}
+
+void ChunkStore::release_chunks(ChunkSet &set)
+{
+    for (auto it = set.groups.begin(); it != set.groups.end(); it++)
+    {
+        for (uint64_t i = 0; i < it->second.size(); i++)
+            Message::release_message(it->second[i]);
+    }
+    set.groups.clear();
+}
+
+// Drops the sets, complete or not, of batches too far behind the newest one.
+void ChunkStore::sweep(uint64_t txn_id)
+{
+    uint64_t window = EC_SET_WINDOW * get_batch_size();
+    if (txn_id < window)
+        return;
+    auto end = sets.lower_bound(make_pair(txn_id - window, (uint64_t)0));
+    for (auto it = sets.begin(); it != end; it++)
+        release_chunks(it->second);
+    sets.erase(sets.begin(), end);
+}
+
+Message *ChunkStore::rebuild(vector<HOTSTUFFChunkMsg *> &group)
+{
+    uint64_t k = g_min_invalid_nodes + 1;
+    vector<uint64_t> idx;
+    vector<string> chunks;
+    for (uint64_t i = group.size() - k; i < group.size(); i++)
+    {
+        idx.push_back(group[i]->chunk_idx);
+        chunks.push_back(group[i]->chunk);
+    }
+
+    HOTSTUFFChunkMsg *first = group[0];
+    string data;
+    RemReqType rtype = NO_MSG;
+    if (ec_decode(idx, chunks, k, first->data_size, data) && data.size() >= sizeof(rtype) &&
+        calculateHash(data) == first->data_hash)
+        memcpy(&rtype, data.data(), sizeof(rtype));
+    if (rtype == HOTSTUFF_PROPOSAL_MSG)
+    {
+        HOTSTUFFProposalMsg *prop = (HOTSTUFFProposalMsg *)Message::create_message(&data[0]);
+        if (prop->get_size() == data.size() && prop->hash == first->hash && prop->get_batch_hash() == prop->hash &&
+            prop->txn_id == first->txn_id && prop->instance_id == first->instance_id && prop->view == first->view)
+        {
+            // Its bytes are what the leader signed, which stands in for the MAC.
+            prop->ec_rebuilt = true;
+            return prop;
+        }
+        Message::release_message(prop);
+    }
+
+    Message::release_message(group[0]);
+    group.erase(group.begin());
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef _ERASURE_CODE_H_
+#define _ERASURE_CODE_H_
+
+#include "global.h"
+
+#if EC_DISSEMINATION
+class Message;
+class HOTSTUFFProposalMsg;
+class HOTSTUFFChunkMsg;
+
+/*
+    Systematic Reed-Solomon style code over GF(2^8). Of the n chunks, the first
+    k carry the data and the rest are Cauchy parity, so any k distinct chunks
+    rebuild the data. Requires n <= 256.
+*/
+void ec_encode(const char *data, uint64_t size, uint64_t k, uint64_t n, vector<string> &chunks);
+bool ec_decode(const vector<uint64_t> &idx, const vector<string> &chunks, uint64_t k, uint64_t size, string &data);
+
+// Splits a proposal into one chunk per replica and sends each its own chunk.
+void send_proposal_chunks(uint64_t thd_id, HOTSTUFFProposalMsg *prop);
+
+// Collects the chunks of proposals until they can be rebuilt.
+class ChunkStore
+{
+public:
+    Message *add(uint64_t thd_id, HOTSTUFFChunkMsg *cmsg);
+
+private:
+    struct ChunkSet
+    {
+        bool done = false; // rebuilt; kept without chunks until swept
+        vector<bool> seen;  // chunk indices already accepted
+        // Chunks grouped by the leader-signed proposal digest they carry.
+        map<string, vector<HOTSTUFFChunkMsg *>> groups;
+    };
+    Message *rebuild(vector<HOTSTUFFChunkMsg *> &group);
+    void release_chunks(ChunkSet &set);
+    void sweep(uint64_t txn_id);
+
+    std::mutex lock;
+    map<pair<uint64_t, uint64_t>, ChunkSet> sets; // txn_id,instance_id : chunks
+    uint64_t newest_txn = 0;
+};
+
+extern ChunkStore chunk_store;
+#endif
+
+#endif
@@ -158,6 +158,9 @@ uint64_t receivedKeys[NODE_CNT + CLIENT_NODE_CNT];
 std::mutex keyMTX;
 bool keyAvail = false;
 uint64_t totKey = 0;
+#if QUORUM_START
+std::atomic<bool> readySent(false); // READY went out to the clients
+#endif
 
 uint64_t indexSize = 2 * g_client_node_cnt * g_inflight_max;
 #if RING_BFT || SHARPER
@@ -328,6 +331,7 @@ uint64_t sock_ctr[REM_THREAD_CNT] = {0};
 uint64_t get_next_socket(uint64_t tid, uint64_t size)
 {
 	uint64_t abs_tid = tid % g_this_rem_thread_cnt;
+	assert(size > 0);
 	uint64_t nsock = (sock_ctr[abs_tid] + 1) % size;
 	sock_ctr[abs_tid] = nsock;
 	return nsock;
@@ -350,6 +354,33 @@ vector<uint64_t> nodes_to_send(uint64_t beg, uint64_t end)
 	return dest;
 }
 
+#if TREE_DISSEMINATION
+// Replicas are ranked by their distance from the root; the children of rank r
+// are ranks r*TREE_FANOUT+1 to r*TREE_FANOUT+TREE_FANOUT.
+vector<uint64_t> tree_children(uint64_t root, uint64_t node)
+{
+	vector<uint64_t> dest;
+	uint64_t rank = (node + g_node_cnt - root) % g_node_cnt;
+	for (uint64_t i = 1; i <= TREE_FANOUT; i++)
+	{
+		uint64_t child = rank * TREE_FANOUT + i;
+		if (child >= g_node_cnt)
+		{
+			break;
+		}
+		dest.push_back((child + root) % g_node_cnt);
+	}
+	return dest;
+}
+
+uint64_t tree_parent(uint64_t root, uint64_t node)
+{
+	uint64_t rank = (node + g_node_cnt - root) % g_node_cnt;
+	assert(rank > 0);
+	return ((rank - 1) / TREE_FANOUT + root) % g_node_cnt;
+}
+#endif
+
 // STORAGE OF CLIENT DATA
 uint64_t ClientDataStore[SYNTH_TABLE_SIZE] = {0};
 
@@ -495,6 +526,15 @@ void init_init_msg_sent(){
 #endif
 }
 
+uint64_t setup_quorum()
+{
+#if QUORUM_START
+	return g_node_cnt - g_min_invalid_nodes;
+#else
+	return g_node_cnt;
+#endif
+}
+
 // A min heap storing txn_id of execute_msgs
 std::priority_queue<uint64_t , vector<uint64_t>, greater<uint64_t> > execute_msg_heap;
 std::mutex execute_msg_heap_lock;
@@ -1180,6 +1220,10 @@ double idle_worker_times[THREAD_CNT] = {0};
 // Statistics to print output_thread_idle_times.
 double output_thd_idle_time[SEND_THREAD_CNT] = {0};
 double input_thd_idle_time[REM_THREAD_CNT] = {0};
+#if REBALANCE_INPUT
+double input_thd_busy_time[REM_THREAD_CNT] = {0};
+uint64_t input_sock_moves = 0;
+#endif
 
 //Maps that stores messages of each type.
 #if FIX_CL_INPUT_THREAD_BUG
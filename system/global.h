@@ -78,6 +78,17 @@ typedef int32_t SInt32;
 typedef uint64_t UInt64;
 typedef int64_t SInt64;
 
+// Integer fields of consensus messages go out as varints under COMPACT_WIRE.
+#if COMPACT_WIRE
+#define WIRE_SIZE(v) varint_size(v)
+#define COPY_WIRE_VAL(v, d, p) COPY_VARINT(v, d, p)
+#define COPY_WIRE_BUF(d, v, p) COPY_BUF_VARINT(d, v, p)
+#else
+#define WIRE_SIZE(v) sizeof(v)
+#define COPY_WIRE_VAL(v, d, p) COPY_VAL(v, d, p)
+#define COPY_WIRE_BUF(d, v, p) COPY_BUF(d, v, p)
+#endif
+
 typedef uint64_t ts_t; // time stamp type
 
 /******************************************/
@@ -248,7 +259,10 @@ enum RemReqType
     HOTSTUFF_GENERIC_MSG,   // 24
 #if SEPARATE
     HOTSTUFF_PROPOSAL_MSG,
-    HOTSTUFF_GENERIC_MSG_P  // 26
+    HOTSTUFF_GENERIC_MSG_P,  // 26
+#if EC_DISSEMINATION
+    HOTSTUFF_CHUNK_MSG,
+#endif
 #endif
 #endif
 
@@ -345,6 +359,9 @@ struct KeyPairHex
 extern std::mutex keyMTX;
 extern bool keyAvail;
 extern uint64_t totKey;
+#if QUORUM_START
+extern std::atomic<bool> readySent;
+#endif
 
 extern uint64_t indexSize;
 extern uint64_t g_min_invalid_nodes;
@@ -416,23 +433,28 @@ public:
     uint64_t get_size(){
         uint64_t size = sizeof(bool);
         size += sizeof(QCType); 
-        size += 3*sizeof(uint64_t);
-        size += 2*sizeof(size_t);
+        size += WIRE_SIZE(viewNumber);
+        size += WIRE_SIZE(parent_view);
+        size += WIRE_SIZE(height);
+        size += WIRE_SIZE(batch_hash.length());
+        size += WIRE_SIZE(parent_hash.length());
         size += batch_hash.length();
         size += parent_hash.length();
 
         size += sizeof(bool);
         if(!grand_empty){
-            size += sizeof(uint64_t);
-            size += sizeof(size_t);
+            size += WIRE_SIZE(grand_view);
+            size += WIRE_SIZE(grand_hash.length());
             size += grand_hash.length();
         }
 
 #if THRESHOLD_SIGNATURE
         if(!genesis){
             size_t map_size = signature_share_map.size();
-            size += sizeof(map_size);
-            size += map_size * sizeof(uint64_t);
+            size += WIRE_SIZE(map_size);
+            for(auto it = signature_share_map.begin(); it != signature_share_map.end(); ++it){
+                size += WIRE_SIZE(it->first);
+            }
             size += map_size * sizeof(secp256k1_ecdsa_signature);
         }
 #endif
@@ -442,19 +464,19 @@ public:
     uint64_t copy_from_buf(uint64_t ptr, char *buf){
         COPY_VAL(type, buf, ptr);
     	COPY_VAL(genesis, buf, ptr);
-        COPY_VAL(viewNumber, buf, ptr);
-        COPY_VAL(parent_view, buf, ptr);
-        COPY_VAL(height, buf, ptr);
+        COPY_WIRE_VAL(viewNumber, buf, ptr);
+        COPY_WIRE_VAL(parent_view, buf, ptr);
+        COPY_WIRE_VAL(height, buf, ptr);
 
 		size_t ssize;
-        COPY_VAL(ssize, buf, ptr);
+        COPY_WIRE_VAL(ssize, buf, ptr);
         batch_hash.resize(ssize);
         for(uint j=0; j<ssize; j++){
 		    batch_hash[j] = buf[ptr+j];
 	    }
 
         ptr += ssize;
-        COPY_VAL(ssize, buf, ptr);
+        COPY_WIRE_VAL(ssize, buf, ptr);
         parent_hash.resize(ssize);
         for(uint j=0; j<ssize; j++){
 		    parent_hash[j] = buf[ptr+j];
@@ -463,8 +485,8 @@ public:
 
         COPY_VAL(grand_empty, buf, ptr);
         if(!grand_empty){
-            COPY_VAL(grand_view, buf, ptr);
-            COPY_VAL(ssize, buf, ptr);
+            COPY_WIRE_VAL(grand_view, buf, ptr);
+            COPY_WIRE_VAL(ssize, buf, ptr);
             grand_hash.resize(ssize);
             for(uint j=0; j<ssize; j++){
 		        grand_hash[j] = buf[ptr+j];
@@ -477,9 +499,9 @@ public:
             size_t map_size;
             uint64_t node_id;
             secp256k1_ecdsa_signature sig_share;
-            COPY_VAL(map_size, buf, ptr);
+            COPY_WIRE_VAL(map_size, buf, ptr);
             for(size_t i=0 ; i<map_size; i++){
-                COPY_VAL(node_id, buf, ptr);
+                COPY_WIRE_VAL(node_id, buf, ptr);
                 COPY_VAL(sig_share, buf, ptr);
                 signature_share_map[i] = sig_share;
             }
@@ -491,17 +513,17 @@ public:
     uint64_t copy_to_buf(uint64_t ptr, char *buf){
         COPY_BUF(buf, type, ptr);
     	COPY_BUF(buf, genesis, ptr);
-        COPY_BUF(buf, viewNumber, ptr);
-        COPY_BUF(buf, parent_view, ptr);
-        COPY_BUF(buf, height, ptr);
+        COPY_WIRE_BUF(buf, viewNumber, ptr);
+        COPY_WIRE_BUF(buf, parent_view, ptr);
+        COPY_WIRE_BUF(buf, height, ptr);
         size_t ssize = batch_hash.length();
-        COPY_BUF(buf, ssize, ptr);
+        COPY_WIRE_BUF(buf, ssize, ptr);
         for(uint j=0; j<ssize; j++){
 			buf[ptr+j] = batch_hash[j];
 	    }
 	    ptr += ssize;
         ssize = parent_hash.length();
-        COPY_BUF(buf, ssize, ptr);
+        COPY_WIRE_BUF(buf, ssize, ptr);
         for(uint j=0; j<ssize; j++){
 			buf[ptr+j] = parent_hash[j];
 	    }
@@ -509,9 +531,9 @@ public:
 
         COPY_BUF(buf, grand_empty, ptr);
         if(!grand_empty){
-            COPY_BUF(buf, grand_view, ptr);
+            COPY_WIRE_BUF(buf, grand_view, ptr);
             ssize = grand_hash.length();
-            COPY_BUF(buf, ssize, ptr);
+            COPY_WIRE_BUF(buf, ssize, ptr);
             for(uint j=0; j<ssize; j++){
 			    buf[ptr+j] = grand_hash[j];
 	        }
@@ -522,9 +544,9 @@ public:
         if(!genesis){
             size_t map_size = signature_share_map.size();
             uint i = 0;
-            COPY_BUF(buf, map_size, ptr);
+            COPY_WIRE_BUF(buf, map_size, ptr);
             for(auto it = signature_share_map.begin(); it != signature_share_map.end() && i < map_size; ++it, ++i){
-                COPY_BUF(buf, it->first, ptr);
+                COPY_WIRE_BUF(buf, it->first, ptr);
                 COPY_BUF(buf, it->second, ptr);
             }
         }       
@@ -592,6 +614,10 @@ uint64_t get_next_socket(uint64_t tid, uint64_t size);
 
 // Global Utility functions:
 vector<uint64_t> nodes_to_send(uint64_t beg, uint64_t end); // Destination for msgs.
+#if TREE_DISSEMINATION
+vector<uint64_t> tree_children(uint64_t root, uint64_t node); // Children of node in the dissemination tree.
+uint64_t tree_parent(uint64_t root, uint64_t node); // Parent of node, which is not the root.
+#endif
 
 // STORAGE OF CLIENT DATA
 extern uint64_t ClientDataStore[SYNTH_TABLE_SIZE];
@@ -654,6 +680,8 @@ extern uint64_t init_msg_sent[SEND_THREAD_CNT];
 extern void dec_init_msg_sent(uint64_t td_id);
 extern uint64_t get_init_msg_sent(uint64_t td_id);
 extern void init_init_msg_sent();
+// Replicas, this one included, a node waits for before it starts.
+uint64_t setup_quorum();
 // A min heap storing txn_id of execute_msgs
 extern std::priority_queue<uint64_t , vector<uint64_t>, greater<uint64_t> > execute_msg_heap;
 extern std::mutex execute_msg_heap_lock;
@@ -880,6 +908,10 @@ extern double idle_worker_times[THREAD_CNT];
 // Statistics to print output_thread_idle_times.
 extern double output_thd_idle_time[SEND_THREAD_CNT];
 extern double input_thd_idle_time[REM_THREAD_CNT];
+#if REBALANCE_INPUT
+extern double input_thd_busy_time[REM_THREAD_CNT];
+extern uint64_t input_sock_moves;
+#endif
 
 #if FIX_CL_INPUT_THREAD_BUG
 extern std::mutex client_response_lock;
@@ -220,6 +220,55 @@
 	memcpy(&((char *)d)[p], (char *)&v, s); \
 	p += s;
 
+// LEB128 varints, used by the compact wire format.
+#define COPY_VARINT(v, d, p) \
+	p = varint_from_buf(d, p, v);
+
+#define COPY_BUF_VARINT(d, v, p) \
+	p = varint_to_buf((char *)d, p, v);
+
+inline uint64_t varint_size(uint64_t v)
+{
+	uint64_t n = 1;
+	while (v >= 0x80)
+	{
+		v >>= 7;
+		n++;
+	}
+	return n;
+}
+
+inline uint64_t varint_to_buf(char *buf, uint64_t ptr, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		buf[ptr++] = (char)(v | 0x80);
+		v >>= 7;
+	}
+	buf[ptr++] = (char)v;
+	return ptr;
+}
+
+template <typename T>
+inline uint64_t varint_from_buf(const char *buf, uint64_t ptr, T &v)
+{
+	uint64_t x = 0;
+	uint32_t shift = 0;
+	uint8_t b;
+	do
+	{
+		b = buf[ptr++];
+		x |= (uint64_t)(b & 0x7f) << shift;
+		shift += 7;
+	} while ((b & 0x80) && shift < 64);
+	v = (T)x;
+	return ptr;
+}
+
+// Maps small signed deltas to small varints.
+inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
 #define WRITE_VAL(f, v) \
 	f.write((char *)&v, sizeof(v));
 
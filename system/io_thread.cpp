@@ -12,6 +12,7 @@
 #include "client_txn.h"
 #include "work_queue.h"
 #include "timer.h"
+#include "erasure_code.h"
 //#include "crypto.h"
 
 void InputThread::managekey(KeyExchange *keyex)
@@ -82,7 +83,7 @@ void InputThread::setup()
             {
                 printf("Received INIT_DONE from node %ld\n", msg->return_node_id);
                 fflush(stdout);
-                simulation->process_setup_msg();
+                simulation->process_setup_msg(msg->return_node_id);
                 #if FIX_MEM_LEAK
                 Message::release_message(msg);
                 #endif
@@ -100,7 +101,7 @@ void InputThread::setup()
                     else if (msg->rtype == READY)
                     {
                         totKey++;
-                        if (totKey == g_node_cnt)
+                        if (totKey == setup_quorum())
                         {
                             keyMTX.lock();
                             keyAvail = true;
@@ -207,7 +208,7 @@ RC InputThread::client_recv_loop()
             else if (msg->rtype == READY)
             {
                 totKey++;
-                if (totKey == g_node_cnt)
+                if (totKey == setup_quorum())
                 {
 
                     keyMTX.lock();
@@ -399,6 +400,12 @@ RC InputThread::server_recv_loop()
             fflush(stdout);
             INC_STATS(_thd_id, msg_cl_in, 1);
         }
+#if EC_DISSEMINATION
+        // Chunks stay here until their proposal can be rebuilt.
+        if (msg->rtype == HOTSTUFF_CHUNK_MSG)
+            msg = chunk_store.add(get_thd_id(), (HOTSTUFFChunkMsg *)msg);
+        if (msg != NULL)
+#endif
         work_queue.enqueue(get_thd_id(), msg, false);
         msgs->pop_back();
 
@@ -417,6 +424,11 @@ RC InputThread::server_recv_loop()
                 fflush(stdout);
                 INC_STATS(_thd_id, msg_cl_in, 1);
             }
+#endif
+#if EC_DISSEMINATION
+            if (msg->rtype == HOTSTUFF_CHUNK_MSG)
+                msg = chunk_store.add(get_thd_id(), (HOTSTUFFChunkMsg *)msg);
+            if (msg != NULL)
 #endif
             work_queue.enqueue(get_thd_id(), msg, false);
             msgs->erase(msgs->begin());
@@ -126,7 +126,7 @@ int main(int argc, char *argv[])
     printf("Initializing transaction pool... ");
     fflush(stdout);
     // txn_pool.init(m_wl, 0);
-    txn_pool.init(&wl, 0);
+    txn_pool.init(&wl, PREFAULT ? PREFAULT_POOL_CNT : 0);
     printf("Done\n");
     printf("Initializing txn node table pool... ");
     fflush(stdout);
@@ -135,7 +135,7 @@ int main(int argc, char *argv[])
     printf("Initializing query pool... ");
     fflush(stdout);
     // qry_pool.init(m_wl, 0);
-    qry_pool.init(&wl, 0);
+    qry_pool.init(&wl, PREFAULT ? PREFAULT_POOL_CNT : 0);
     printf("Done\n");
     printf("Initializing transaction table... ");
     fflush(stdout);
@@ -355,6 +355,11 @@ int main(int argc, char *argv[])
         printf("Output %ld: %f\n", i + g_thread_cnt + g_rem_thread_cnt, output_thd_idle_time[i] / BILLION);
     for (uint64_t i = 0; i < g_rem_thread_cnt; i++)
         printf("Input %ld: %f\n", i + g_thread_cnt, input_thd_idle_time[i] / BILLION);
+#if REBALANCE_INPUT
+    for (uint64_t i = 0; i < g_rem_thread_cnt; i++)
+        printf("Input %ld busy: %f util: %f\n", i + g_thread_cnt, input_thd_busy_time[i] / BILLION, input_thd_busy_time[i] / (endtime - starttime));
+    printf("Input socket moves: %ld\n", input_sock_moves);
+#endif
 
     if (STATS_ENABLE)
         stats.print(false);
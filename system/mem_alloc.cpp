@@ -1,16 +1,295 @@
-
 #include "mem_alloc.h"
 #include "global.h"
 #include "jemalloc/jemalloc.h"
+#if SLAB_ALLOC
+#include <sys/mman.h>
+#include <atomic>
+#endif
 
 //#define N_MALLOC
 
+#if HUGE_PAGES
+// Read by jemalloc at startup: huge pages for its arenas and metadata.
+const char *je_malloc_conf = "thp:always,metadata_thp:auto";
+#endif
+
+#if SLAB_ALLOC
+/*
+    Requests of up to SLAB_MAX_SIZE bytes are served from per-thread slabs of
+    SLAB_SIZE bytes, each holding objects of one size class. Slabs are carved
+    from one reserved region, so a pointer tells by its address whether it is
+    a slab object, and which thread and class its slab belongs to. A thread
+    frees objects of its own slabs straight into its free lists. Objects of
+    other threads' slabs are gathered per owner and handed over in batches of
+    SLAB_REMOTE_BATCH, which the owner takes in once its free list runs dry.
+*/
+#define SLAB_MAX_CACHES 256
+#define SLAB_HUGE_PAGE (1UL << 21)
+
+static const uint32_t slab_sizes[SLAB_CLASS_CNT] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512};
+
+struct SlabFree
+{
+    SlabFree *next;
+};
+
+struct SlabMeta
+{
+    uint16_t cache;
+    uint16_t cls;
+};
+
+struct SlabBatch
+{
+    SlabFree *head;
+    SlabFree *tail;
+    uint64_t cnt;
+};
+
+struct SlabCache
+{
+    uint32_t id;
+    SlabFree *free_list[SLAB_CLASS_CNT];
+    SlabBatch remote[SLAB_MAX_CACHES]; // frees bound for each other cache
+    std::atomic<SlabFree *> inbox;     // batches handed over by other threads
+    SlabClassStats stats[SLAB_CLASS_CNT];
+};
+
+static std::atomic<char *> slab_region(NULL);
+static uint64_t slab_cnt = 0;
+static SlabMeta *slab_meta = NULL;
+static std::atomic<uint64_t> slab_next(0);
+static SlabCache *slab_caches[SLAB_MAX_CACHES];
+static std::atomic<uint32_t> slab_cache_cnt(0);
+static uint8_t slab_class_of[SLAB_MAX_SIZE / 16 + 1];
+static pthread_once_t slab_once = PTHREAD_ONCE_INIT;
+static __thread SlabCache *slab_cache = NULL;
+static __thread bool slab_cache_set = false;
+
+// Maps the region, backed by huge pages and faulted in up front if asked to.
+static char *slab_map_region(uint64_t &size)
+{
+#if HUGE_PAGES_EXPLICIT && PREFAULT
+    // Only the pre-faulted slabs, so the hugetlb pool is reserved up front and
+    // a run cannot fault on an exhausted pool later.
+    size = PREFAULT_SLAB_SIZE;
+    void *huge = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    if (huge != MAP_FAILED)
+        return (char *)huge;
+    printf("No %lu bytes of explicit huge pages for slabs, using regular pages\n", size);
+#endif
+    size = SLAB_REGION_SIZE;
+    // One huge page of slack, so the slabs start on a huge page boundary.
+    void *region = mmap(NULL, size + SLAB_HUGE_PAGE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED)
+        return NULL;
+    char *start = (char *)(((uint64_t)region + SLAB_HUGE_PAGE - 1) & ~(SLAB_HUGE_PAGE - 1));
+#if HUGE_PAGES
+    madvise(start, size, MADV_HUGEPAGE);
+#endif
+#if PREFAULT
+    // Slabs are handed out from the front, so these are the first ones used.
+    uint64_t page = sysconf(_SC_PAGESIZE);
+    for (uint64_t off = 0; off < PREFAULT_SLAB_SIZE && off < size; off += page)
+        start[off] = 0;
+#endif
+    return start;
+}
+
+static void slab_init()
+{
+    void *meta = mmap(NULL, SLAB_REGION_SIZE / SLAB_SIZE * sizeof(SlabMeta), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    uint64_t size = 0;
+    char *region = meta == MAP_FAILED ? NULL : slab_map_region(size);
+    if (region == NULL)
+    {
+        // Everything goes to jemalloc instead.
+        printf("Slab region of %lu bytes could not be reserved\n", (uint64_t)SLAB_REGION_SIZE);
+        return;
+    }
+    uint32_t cls = 0;
+    for (uint32_t i = 0; i <= SLAB_MAX_SIZE / 16; i++)
+    {
+        while (slab_sizes[cls] < i * 16)
+            cls++;
+        slab_class_of[i] = cls;
+    }
+    slab_meta = (SlabMeta *)meta;
+    slab_cnt = size / SLAB_SIZE;
+    slab_region.store(region);
+}
+
+// The calling thread's cache, or NULL if slabs are off for it.
+static inline SlabCache *slab_get_cache()
+{
+    if (slab_cache_set)
+        return slab_cache;
+    slab_cache_set = true;
+    pthread_once(&slab_once, slab_init);
+    if (slab_region.load() == NULL)
+        return NULL;
+    uint32_t id = slab_cache_cnt.fetch_add(1);
+    if (id >= SLAB_MAX_CACHES)
+        return NULL;
+    SlabCache *cache = new SlabCache();
+    cache->id = id;
+    cache->inbox.store(NULL);
+    slab_caches[id] = cache;
+    slab_cache = cache;
+    return cache;
+}
+
+static inline bool slab_owns(void *ptr)
+{
+    char *region = slab_region.load(std::memory_order_relaxed);
+    return region && (uint64_t)((char *)ptr - region) < slab_cnt * SLAB_SIZE;
+}
+
+static inline SlabMeta &slab_meta_of(void *ptr)
+{
+    return slab_meta[((char *)ptr - slab_region.load(std::memory_order_relaxed)) / SLAB_SIZE];
+}
+
+// Takes in the objects other threads handed back.
+static void slab_drain(SlabCache *cache)
+{
+    if (cache->inbox.load(std::memory_order_relaxed) == NULL)
+        return;
+    SlabFree *obj = cache->inbox.exchange(NULL, std::memory_order_acquire);
+    while (obj)
+    {
+        SlabFree *next = obj->next;
+        uint16_t cls = slab_meta_of(obj).cls;
+        obj->next = cache->free_list[cls];
+        cache->free_list[cls] = obj;
+        obj = next;
+    }
+}
+
+static bool slab_refill(SlabCache *cache, uint32_t cls)
+{
+    uint64_t idx = slab_next.fetch_add(1);
+    if (idx >= slab_cnt)
+        return false;
+    slab_meta[idx].cache = cache->id;
+    slab_meta[idx].cls = cls;
+    char *slab = slab_region.load(std::memory_order_relaxed) + idx * SLAB_SIZE;
+    uint64_t size = slab_sizes[cls];
+    SlabFree *head = cache->free_list[cls];
+    for (uint64_t off = SLAB_SIZE / size * size; off > 0; off -= size)
+    {
+        SlabFree *obj = (SlabFree *)(slab + off - size);
+        obj->next = head;
+        head = obj;
+    }
+    cache->free_list[cls] = head;
+    cache->stats[cls].slabs++;
+    return true;
+}
+
+static inline void *slab_alloc(uint64_t size)
+{
+    SlabCache *cache = slab_get_cache();
+    if (cache == NULL)
+        return NULL;
+    uint32_t cls = slab_class_of[(size + 15) >> 4];
+    if (cache->free_list[cls] == NULL)
+    {
+        slab_drain(cache);
+        if (cache->free_list[cls] == NULL && !slab_refill(cache, cls))
+            return NULL;
+    }
+    SlabFree *obj = cache->free_list[cls];
+    cache->free_list[cls] = obj->next;
+    cache->stats[cls].allocs++;
+    return obj;
+}
+
+static inline void slab_hand_over(SlabCache *owner, SlabFree *head, SlabFree *tail)
+{
+    SlabFree *old = owner->inbox.load(std::memory_order_relaxed);
+    do
+    {
+        tail->next = old;
+    } while (!owner->inbox.compare_exchange_weak(old, head, std::memory_order_release, std::memory_order_relaxed));
+}
+
+static inline void slab_free(void *ptr)
+{
+    SlabMeta &meta = slab_meta_of(ptr);
+    SlabFree *obj = (SlabFree *)ptr;
+    SlabCache *cache = slab_get_cache();
+    if (cache && meta.cache == cache->id)
+    {
+        obj->next = cache->free_list[meta.cls];
+        cache->free_list[meta.cls] = obj;
+        cache->stats[meta.cls].frees++;
+        return;
+    }
+    if (cache == NULL)
+    {
+        slab_hand_over(slab_caches[meta.cache], obj, obj);
+        return;
+    }
+    cache->stats[meta.cls].remote_frees++;
+    SlabBatch &batch = cache->remote[meta.cache];
+    obj->next = batch.head;
+    if (batch.head == NULL)
+        batch.tail = obj;
+    batch.head = obj;
+    if (++batch.cnt >= SLAB_REMOTE_BATCH)
+    {
+        slab_hand_over(slab_caches[meta.cache], batch.head, batch.tail);
+        batch.head = NULL;
+        batch.tail = NULL;
+        batch.cnt = 0;
+    }
+}
+
+// Per size class counters, merged over all threads.
+void mem_alloc::print_slabs(FILE *outf)
+{
+    uint32_t cache_cnt = slab_cache_cnt.load();
+    if (cache_cnt > SLAB_MAX_CACHES)
+        cache_cnt = SLAB_MAX_CACHES;
+    for (uint32_t cls = 0; cls < SLAB_CLASS_CNT; cls++)
+    {
+        SlabClassStats total = {0, 0, 0, 0};
+        for (uint32_t i = 0; i < cache_cnt; i++)
+        {
+            if (slab_caches[i] == NULL)
+                continue;
+            SlabClassStats &s = slab_caches[i]->stats[cls];
+            total.allocs += s.allocs;
+            total.frees += s.frees;
+            total.remote_frees += s.remote_frees;
+            total.slabs += s.slabs;
+        }
+        if (total.allocs == 0)
+            continue;
+        fprintf(outf, "\nslab_%u: allocs=%ld frees=%ld remote_frees=%ld slabs=%ld",
+                slab_sizes[cls], total.allocs, total.frees, total.remote_frees, total.slabs);
+    }
+    fprintf(outf, "\nslab_threads=%u slabs_used=%ld\n", cache_cnt, slab_next.load());
+}
+#endif
+
 void mem_alloc::free(void *ptr, uint64_t size)
 {
     if (NO_FREE)
     {
     }
     DEBUG_M("free %ld 0x%lx\n", size, (uint64_t)ptr);
+#if SLAB_ALLOC
+    if (slab_owns(ptr))
+    {
+        slab_free(ptr);
+        return;
+    }
+#endif
 #ifdef N_MALLOC
     std::free(ptr);
 #else
@@ -23,6 +302,10 @@ void *mem_alloc::alloc(uint64_t size)
 {
     void *ptr;
 
+#if SLAB_ALLOC
+    if (size <= SLAB_MAX_SIZE && (ptr = slab_alloc(size)) != NULL)
+        return ptr;
+#endif
 #ifdef N_MALLOC
     ptr = malloc(size);
 #else
@@ -34,14 +317,27 @@ void *mem_alloc::alloc(uint64_t size)
     return ptr;
 }
 
+// Sizes are rounded up to whole cache lines, which slab classes keep aligned.
 void *mem_alloc::align_alloc(uint64_t size)
 {
-    uint64_t aligned_size = size + CL_SIZE - (size % CL_SIZE);
+    uint64_t aligned_size = (size + CL_SIZE - 1) / CL_SIZE * CL_SIZE;
     return alloc(aligned_size);
 }
 
 void *mem_alloc::realloc(void *ptr, uint64_t size)
 {
+#if SLAB_ALLOC
+    if (slab_owns(ptr))
+    {
+        uint64_t old_size = slab_sizes[slab_meta_of(ptr).cls];
+        if (size <= old_size)
+            return ptr;
+        void *_ptr = alloc(size);
+        memcpy(_ptr, ptr, old_size);
+        free(ptr, old_size);
+        return _ptr;
+    }
+#endif
 #ifdef N_MALLOC
     void *_ptr = std::realloc(ptr, size);
 #else
@@ -3,6 +3,20 @@
 
 #include "global.h"
 
+#if SLAB_ALLOC
+#define SLAB_CLASS_CNT 10
+#define SLAB_MAX_SIZE 512
+
+// Counters of one size class, kept per thread and merged when printed.
+struct SlabClassStats
+{
+    uint64_t allocs;
+    uint64_t frees;        // of objects from this thread's slabs
+    uint64_t remote_frees; // of objects from other threads' slabs
+    uint64_t slabs;
+};
+#endif
+
 class mem_alloc
 {
 public:
@@ -10,6 +24,9 @@ public:
     void *align_alloc(uint64_t size);
     void *realloc(void *ptr, uint64_t size);
     void free(void *block, uint64_t size);
+#if SLAB_ALLOC
+    void print_slabs(FILE *outf);
+#endif
 };
 
 #endif
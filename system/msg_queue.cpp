@@ -78,6 +78,7 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
         assert(0);
         return;
     }
+    entry->sign_hint = dest.size();
 
     /* 
         We sign the messages here before sending it to some replica.
@@ -90,12 +91,12 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
         break;
     case CL_RSP:
         ((ClientResponseMessage *)msg)->sign(dest[0]);
-        entry->allsign.push_back(((ClientResponseMessage *)msg)->signature);
+        entry->add_sign(((ClientResponseMessage *)msg)->signature);
         break;
 
     case CL_BATCH:
         ((ClientQueryBatch *)msg)->sign(dest[0]);
-        entry->allsign.push_back(msg->signature);
+        entry->add_sign(msg->signature);
         break;
 #if SHARPER
     case SUPER_PROPOSE:
@@ -104,21 +105,21 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
         for (uint64_t i = 0; i < dest.size(); i++)
         {
             ((BatchRequests *)msg)->sign(dest[i]);
-            entry->allsign.push_back(msg->signature);
+            entry->add_sign(msg->signature);
         }
         break;
     case PBFT_CHKPT_MSG:
         for (uint64_t i = 0; i < dest.size(); i++)
         {
             ((CheckpointMessage *)msg)->sign(dest[i]);
-            entry->allsign.push_back(((CheckpointMessage *)msg)->signature);
+            entry->add_sign(((CheckpointMessage *)msg)->signature);
         }
         break;
     case PBFT_PREP_MSG:
         for (uint64_t i = 0; i < dest.size(); i++)
         {
             ((PBFTPrepMessage *)msg)->sign(dest[i]);
-            entry->allsign.push_back(((PBFTPrepMessage *)msg)->signature);
+            entry->add_sign(((PBFTPrepMessage *)msg)->signature);
         }
         break;
 
@@ -127,7 +128,7 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
         for (uint64_t i = 0; i < dest.size(); i++)
         {
             ((PBFTCommitMessage *)msg)->sign(dest[i]);
-            entry->allsign.push_back(((PBFTCommitMessage *)msg)->signature);
+            entry->add_sign(((PBFTCommitMessage *)msg)->signature);
         }
         break;
 #elif RING_BFT
@@ -138,7 +139,7 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
             ((PBFTCommitMessage *)msg)->sign(dest[0]);
             for (uint64_t i = 0; i < dest.size(); i++)
             {
-                entry->allsign.push_back(((PBFTCommitMessage *)msg)->signature);
+                entry->add_sign(((PBFTCommitMessage *)msg)->signature);
             }
         }
         else
@@ -147,7 +148,7 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
             for (uint64_t i = 0; i < dest.size(); i++)
             {
                 ((PBFTCommitMessage *)msg)->sign(dest[i]);
-                entry->allsign.push_back(((PBFTCommitMessage *)msg)->signature);
+                entry->add_sign(((PBFTCommitMessage *)msg)->signature);
             }
         }
         break;
@@ -156,14 +157,14 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
             ((CommitCertificateMessage *)msg)->sign(dest[0]);
         for (uint64_t i = 0; i < dest.size(); i++)
         {
-            entry->allsign.push_back(((CommitCertificateMessage *)msg)->signature);
+            entry->add_sign(((CommitCertificateMessage *)msg)->signature);
         }
         break;
     case RING_PRE_PREPARE:
         for (uint64_t i = 0; i < dest.size(); i++)
         {
             ((RingBFTPrePrepare *)msg)->sign(dest[i]);
-            entry->allsign.push_back(msg->signature);
+            entry->add_sign(msg->signature);
         }
         break;
     case RING_COMMIT:
@@ -171,7 +172,7 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
             ((RingBFTCommit *)msg)->sign(dest[0]);
         for (uint64_t i = 0; i < dest.size(); i++)
         {
-            entry->allsign.push_back(((RingBFTCommit *)msg)->signature);
+            entry->add_sign(((RingBFTCommit *)msg)->signature);
         }
         break;
 #endif
@@ -181,14 +182,14 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
         for (uint64_t i = 0; i < dest.size(); i++)
         {
             ((ViewChangeMsg *)msg)->sign(dest[i]);
-            entry->allsign.push_back(((ViewChangeMsg *)msg)->signature);
+            entry->add_sign(((ViewChangeMsg *)msg)->signature);
         }
         break;
     case NEW_VIEW:
         for (uint64_t i = 0; i < dest.size(); i++)
         {
             ((NewViewMsg *)msg)->sign(dest[i]);
-            entry->allsign.push_back(((NewViewMsg *)msg)->signature);
+            entry->add_sign(((NewViewMsg *)msg)->signature);
         }
         break;
 #endif
@@ -216,11 +217,14 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
         ((HOTSTUFFDecideMsg *)msg)->sign(dest[0]);
         break;
     case HOTSTUFF_NEW_VIEW_MSG:
-#if MAC_SYNC
+#if VOTE_BUNDLE
+        // Authenticated by the MAC of the frame that carries it.
+        break;
+#elif MAC_SYNC
         for (uint64_t i = 0; i < dest.size(); i++)
         {
             ((HOTSTUFFNewViewMsg *)msg)->sign(dest[i]);
-            entry->allsign.push_back(((HOTSTUFFNewViewMsg *)msg)->signature);
+            entry->add_sign(((HOTSTUFFNewViewMsg *)msg)->signature);
         }
 #else
         ((HOTSTUFFNewViewMsg *)msg)->sign(dest[0]);
@@ -234,6 +238,11 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
         ((HOTSTUFFProposalMsg *)msg)->sign(dest[0]);
         break;
 #endif
+#if EC_DISSEMINATION
+    case HOTSTUFF_CHUNK_MSG:
+        ((HOTSTUFFChunkMsg *)msg)->sign(dest[0]);
+        break;
+#endif
 #endif
     default:
         break;
@@ -299,6 +308,9 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
 #if SEPARATE
     case HOTSTUFF_PROPOSAL_MSG:
 #endif
+#if EC_DISSEMINATION
+    case HOTSTUFF_CHUNK_MSG:
+#endif
 #endif
     {
         // Putting in queue of all the output threads as destinations differ.
@@ -323,10 +335,9 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
             {
                 entry2->msg->dest.push_back(dest[i]);
             }
-            for (uint64_t i = 0; i < entry->allsign.size(); i++)
-            {
-                entry2->allsign.push_back(entry->allsign[i]);
-            }
+            entry2->signs = entry->signs;
+            entry2->sign_len = entry->sign_len;
+            entry2->sign_cnt = entry->sign_cnt;
             entry2->starttime = get_sys_clock();
 
             while (!m_queue[j]->push(entry2) && !simulation->is_done())
@@ -376,7 +387,7 @@ void MessageQueue::enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t>
     }
 }
 
-void MessageQueue::dequeue(uint64_t thd_id, vector<string> &allsign, Message *&msg)
+msg_entry *MessageQueue::dequeue(uint64_t thd_id)
 {
     msg_entry *entry = NULL;
     // vector<uint64_t> dest;
@@ -413,7 +424,7 @@ void MessageQueue::dequeue(uint64_t thd_id, vector<string> &allsign, Message *&m
             {
                 sthd_m_cache[td_id % g_this_send_thread_cnt] = entry;
                 INC_STATS(thd_id, mtx[5], get_sys_clock() - curr_time);
-                return UINT64_MAX;
+                return NULL;
             }
             else
             {
@@ -428,33 +439,20 @@ void MessageQueue::dequeue(uint64_t thd_id, vector<string> &allsign, Message *&m
 
 #endif
 
-        msg = entry->msg;
-        allsign = entry->allsign;
-        // for (uint64_t i = 0; i < msg->dest.size(); i++)
-        // {
-        //     dest.push_back(msg->dest[i]);
-        // }
-        // for (uint64_t i = 0; i < entry->allsign.size(); i++)
-        // {
-        //     allsign.push_back(entry->allsign[i]);
-        // }
-
-        //printf("MQ Dequeue: %d :: Thd: %ld \n",msg->rtype,thd_id);
+        //printf("MQ Dequeue: %d :: Thd: %ld \n",entry->msg->rtype,thd_id);
         //fflush(stdout);
 
         INC_STATS(thd_id, msg_queue_delay_time, curr_time - entry->starttime);
         INC_STATS(thd_id, msg_queue_cnt, 1);
-        msg->mq_time = curr_time - entry->starttime;
-        DEBUG_M("MessageQueue::enqueue msg_entry free\n");
-    //     entry->allsign.clear();
-    //     mem_allocator.free(entry, sizeof(struct msg_entry));
-    // }
-    // else
-    // {
-        delete entry;
-        return;
+        entry->msg->mq_time = curr_time - entry->starttime;
+        return entry;
     }
-    msg = NULL;
-    // return dest;
-    return;
+    return NULL;
+}
+
+void MessageQueue::free_entry(msg_entry *entry)
+{
+    DEBUG_M("MessageQueue::dequeue msg_entry free\n");
+    entry->~msg_entry();
+    mem_allocator.free(entry, sizeof(struct msg_entry));
 }
@@ -11,10 +11,28 @@ class Message;
 class msg_entry
 {
 public:
-    ~msg_entry(){ this->allsign.clear(); }
     Message *msg;
     uint64_t starttime;
-    vector<string> allsign;
+
+    // Signatures for msg->dest, in the same order, stored back to back.
+    // All of them are sign_len bytes long.
+    string signs;
+    uint32_t sign_len = 0;
+    uint32_t sign_cnt = 0;
+    uint32_t sign_hint = 0; // Expected number of signatures
+
+    void add_sign(const string &sign)
+    {
+        if (sign_cnt == 0)
+        {
+            sign_len = sign.size();
+            signs.reserve(sign_len * sign_hint);
+        }
+        assert(sign.size() == sign_len);
+        signs.append(sign);
+        sign_cnt++;
+    }
+    const char *get_sign(uint64_t i) { return &signs[i * sign_len]; }
 };
 
 typedef msg_entry *msg_entry_t;
@@ -26,8 +44,9 @@ public:
     void release();
     
     void enqueue(uint64_t thd_id, Message *msg, const vector<uint64_t> &dest);
-    // vector<uint64_t> dequeue(uint64_t thd_id, vector<string> &allsign, Message *&msg);
-    void dequeue(uint64_t thd_id, vector<string> &allsign, Message *&msg);
+    // The caller owns the entry until it hands it back to free_entry.
+    msg_entry *dequeue(uint64_t thd_id);
+    void free_entry(msg_entry *entry);
 
 private:
 // This is close to max capacity for boost
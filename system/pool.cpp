@@ -27,8 +27,8 @@ void TxnManPool::init(Workload *wl, uint64_t size)
         for (uint64_t i = 0; i < size; i++)
         {
             _wl->get_txn_man(txn);
-            // txn->init(thd_id, _wl);
-            put(thd_id, txn);
+            // Not put(), which releases state a fresh manager does not have.
+            pool[thd_id]->push(txn);
         }
     }
 }
@@ -68,9 +68,8 @@ void TxnManPool::put(uint64_t txn_id, TxnManager *item)
 
     if (tries >= TRY_LIMIT)
     {
-        // mem_allocator.free(item, sizeof(TxnManager));
-        // // Delete
-        delete item;
+        item->~TxnManager();
+        mem_allocator.free(item, sizeof(TxnManager));
     }
     
 }
@@ -82,9 +81,8 @@ void TxnManPool::free_all()
     {
         while (pool[thd_id]->pop(item))
         {
-            // mem_allocator.free(item, sizeof(TxnManager));
-            // // Delete
-            delete item;
+            item->~TxnManager();
+            mem_allocator.free(item, sizeof(TxnManager));
         }
     }
 }
@@ -141,9 +139,7 @@ void TxnPool::put(uint64_t pool_id, Transaction *item)
     }
     if (tries >= TRY_LIMIT)
     {
-        // item->release(pool_id);
-        // mem_allocator.free(item, sizeof(Transaction));
-        delete item;
+        mem_allocator.free(item, sizeof(Transaction));
     }
 }
 
@@ -154,8 +150,7 @@ void TxnPool::free_all()
     {
         while (pool[thd_id]->pop(item))
         {
-            // mem_allocator.free(item, sizeof(Transaction));
-            delete item;
+            mem_allocator.free(item, sizeof(Transaction));
         }
     }
 }
@@ -302,7 +297,7 @@ void TxnTablePool::free_all()
     {
         while (pool[thd_id]->pop(item))
         {
-            mem_allocator.free(item, sizeof(item));
+            mem_allocator.free(item, sizeof(txn_node));
         }
     }
 }
@@ -13,7 +13,12 @@ void SimManager::init()
     epoch_txn_cnt = 0;
     worker_epoch = 1;
     seq_epoch = 0;
+#if QUORUM_START
+    // Only INIT_DONE of replicas counts; clients and late replicas join later.
+    rsp_cnt = ISSERVER ? setup_quorum() - 1 : setup_quorum();
+#else
     rsp_cnt = g_total_node_cnt - 1;
+#endif
 
 #if TIME_ENABLE
     run_starttime = get_sys_clock();
@@ -86,8 +91,12 @@ void SimManager::set_done()
     }
 }
 
-void SimManager::process_setup_msg()
+void SimManager::process_setup_msg(uint64_t node_id)
 {
+#if QUORUM_START
+    if (!ISSERVERN(node_id))
+        return;
+#endif
     uint64_t rsp_left = ATOM_SUB_FETCH(rsp_cnt, 1);
     if (rsp_left == 0)
     {
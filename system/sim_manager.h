@@ -29,7 +29,7 @@ public:
     void set_done();
     bool timeout();
     void set_starttime(uint64_t starttime);
-    void process_setup_msg();
+    void process_setup_msg(uint64_t node_id);
     void inc_txn_cnt();
     void inc_inflight_cnt();
     void dec_inflight_cnt();
@@ -12,8 +12,8 @@
 // void TxnTable::init()
 void TxnTable::init(Workload *wl)
 {
-    txn_man_pool.init(wl,0);
-    txn_table_pool.init(wl,0);
+    txn_man_pool.init(wl, PREFAULT ? PREFAULT_POOL_CNT : 0);
+    txn_table_pool.init(wl, PREFAULT ? PREFAULT_POOL_CNT : 0);
     DEBUG_M("TxnTable::init pool_node alloc\n");
     pool_size = indexSize + 1;
     pool = (pool_node **)mem_allocator.align_alloc(sizeof(pool_node *) * pool_size);
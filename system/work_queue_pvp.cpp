@@ -269,7 +269,7 @@ Message * QWorkQueue::dequeue(uint64_t thd_id) {
           if(get_incomplete_proposal_cnt(expectedInstance) != 0 && g_node_id == get_view_primary(get_current_view(expectedInstance), expectedInstance)){
             valid = true;
             uint64_t txn_id = (get_last_sent_view(expectedInstance) * num_instances + expectedInstance) * get_batch_size() + get_batch_size() - 1;
-            entry = new work_queue_entry;
+            entry = (work_queue_entry*)mem_allocator.align_alloc(sizeof(work_queue_entry));
             entry->msg = Message::create_message(HOTSTUFF_GENERIC_MSG);
             entry->msg->rtype = HOTSTUFF_GENERIC_MSG_P;
             entry->msg->txn_id = txn_id;
@@ -363,7 +363,7 @@ Message * QWorkQueue::dequeue(uint64_t thd_id) {
           if(get_incomplete_proposal_cnt(expectedInstance) != 0 && g_node_id == get_view_primary(get_current_view(expectedInstance), expectedInstance)){
             valid = true;
             uint64_t txn_id = (get_last_sent_view(expectedInstance) * num_instances + expectedInstance) * get_batch_size() + get_batch_size() - 1;
-            entry = new work_queue_entry;
+            entry = (work_queue_entry*)mem_allocator.align_alloc(sizeof(work_queue_entry));
             entry->msg = Message::create_message(HOTSTUFF_GENERIC_MSG);
             entry->msg->rtype = HOTSTUFF_GENERIC_MSG_P;
             entry->msg->txn_id = txn_id;
@@ -9,6 +9,7 @@
 #include "math.h"
 #include "msg_thread.h"
 #include "msg_queue.h"
+#include "transport.h"
 #include "work_queue.h"
 #include "message.h"
 #include "timer.h"
@@ -18,7 +19,8 @@
 
 WorkerThread::~WorkerThread() {
      if(txn_man){
-         delete txn_man;
+         txn_man->~TxnManager();
+         mem_allocator.free(txn_man, sizeof(TxnManager));
          txn_man = nullptr;
      }
  }
@@ -298,7 +300,25 @@ RC WorkerThread::process_key_exchange(Message *msg)
     bool sendReady = true;
     //Check if we have the keys of every node
     uint64_t totnodes = g_node_cnt + g_client_node_cnt;
+#if QUORUM_START
+    // Only a quorum of replicas is awaited; keys of the others arrive late
+    // through this same path and are stored without a second READY.
+    uint64_t keyed_replicas = 0;
+    for (uint64_t i = 0; i < g_node_cnt; i++)
+    {
+        if (receivedKeys[i] == 0)
+        {
+            keyed_replicas++;
+        }
+    }
+    if (keyed_replicas < setup_quorum())
+    {
+        sendReady = false;
+    }
+    for (uint64_t i = g_node_cnt; i < totnodes; i++)
+#else
     for (uint64_t i = 0; i < totnodes; i++)
+#endif
     {
         if (receivedKeys[i] != 0)
         {
@@ -307,7 +327,14 @@ RC WorkerThread::process_key_exchange(Message *msg)
     }
 
 #if THRESHOLD_SIGNATURE
-    if(public_keys.size() < g_node_cnt)
+    if(public_keys.size() < setup_quorum())
+    {
+        sendReady = false;
+    }
+#endif
+
+#if QUORUM_START
+    if (sendReady && readySent.exchange(true))
     {
         sendReady = false;
     }
@@ -479,9 +506,7 @@ void WorkerThread::check_for_timeout()
         }
         tman->send_hotstuff_newview();
 #else
-        stop_lock.lock();
-        stop_node_set.insert(get_current_view(get_thd_id()) % g_node_cnt);
-        stop_lock.unlock();
+        tport_man.mark_failed_node(get_current_view(get_thd_id()) % g_node_cnt);
         bool failednode = false;
         do{
             // Proceed to the next view
@@ -524,9 +549,7 @@ void WorkerThread::check_for_timeout()
             set_view(instance_id, get_current_view(instance_id) + 1);
             tman->send_hotstuff_newview();
     #else
-            stop_lock.lock();
-            stop_node_set.insert(get_view_primary(get_current_view(instance_id), instance_id));
-            stop_lock.unlock();
+            tport_man.mark_failed_node(get_view_primary(get_current_view(instance_id), instance_id));
             bool failednode = false;
             do{
                 // Proceed to the next view
@@ -676,8 +699,12 @@ void WorkerThread::client_query_check(ClientQueryBatch *clbtch)
 
     //start timer when client broadcasts an unexecuted message
     // Last request of the batch.
+#if SOA_BATCH
+    add_timer(clbtch, calculateHash(clbtch->reqs.getString(clbtch->batch_size - 1)));
+#else
     YCSBClientQueryMessage *qry = clbtch->cqrySet[clbtch->batch_size - 1];
     add_timer(clbtch, calculateHash(qry->getString()));
+#endif
 
     // Forward to the primary.
     vector<uint64_t> dest;
@@ -1199,6 +1226,28 @@ void WorkerThread::init_txn_man(YCSBClientQueryMessage *clqry)
     }
 }
 #endif
+
+#if SOA_BATCH
+/**
+ * This function sets up the txn manager from query i of a batch.
+ *
+ * @param reqs Client Queries of the batch.
+ * @param i Position of the query in the batch.
+*/
+void WorkerThread::init_txn_man(RequestColumns &reqs, uint64_t i)
+{
+    txn_man->client_id = reqs.return_node[i];
+    txn_man->client_startts = reqs.client_ts[i];
+    YCSBQuery *query = (YCSBQuery *)(txn_man->query);
+    for (uint64_t j = i * reqs.reqs_per_query; j < (i + 1) * reqs.reqs_per_query; j++)
+    {
+        ycsb_request *req = (ycsb_request *)mem_allocator.alloc(sizeof(ycsb_request));
+        req->key = reqs.keys[j];
+        req->value = reqs.values[j];
+        query->requests.add(req);
+    }
+}
+#endif
 /**
  * Create an message of type ExecuteMessage, to notify the execute-thread that this 
  * batch of transactions are ready to be executed. This message is placed in one of the 
@@ -1703,8 +1752,12 @@ void WorkerThread::create_and_send_batchreq(ClientQueryBatch *msg, uint64_t tid)
     // Starting index for this batch of transactions.
     next_set = tid;
 
+#if BINARY_DIGEST
+    BatchDigest digest;
+#else
     // String of transactions in a batch to generate hash.
     string batchStr;
+#endif
 
     // Allocate transaction manager for all the requests in batch.
     for (uint64_t i = 0; i < get_batch_size(); i++)
@@ -1724,13 +1777,30 @@ void WorkerThread::create_and_send_batchreq(ClientQueryBatch *msg, uint64_t tid)
         // Fields that need to updated according to the specific algorithm.
         algorithm_specific_update(msg, i);
 
+#if SOA_BATCH
+        // The BatchRequests message still carries whole query messages.
+        YCSBClientQueryMessage *clqry = msg->reqs.get_query(i);
+        init_txn_man(clqry);
+#if BINARY_DIGEST
+        digest.add(clqry);
+#else
+        batchStr += clqry->getString();
+#endif
+        breq->copy_from_txn(txn_man, clqry);
+        Message::release_message(clqry);
+#else
         init_txn_man(msg->cqrySet[i]);
 
+#if BINARY_DIGEST
+        digest.add(msg->cqrySet[i]);
+#else
         // Append string representation of this txn.
         batchStr += msg->cqrySet[i]->getString();
+#endif
 
         // Setting up data for BatchRequests Message.
         breq->copy_from_txn(txn_man, msg->cqrySet[i]);
+#endif
 
         // Reset this txn manager.
         bool ready = txn_man->set_ready();
@@ -1741,7 +1811,11 @@ void WorkerThread::create_and_send_batchreq(ClientQueryBatch *msg, uint64_t tid)
     unset_ready_txn(txn_man);
 
     // Generating the hash representing the whole batch in last txn man.
+#if BINARY_DIGEST
+    txn_man->set_hash(digest.get_hash());
+#else
     txn_man->set_hash(calculateHash(batchStr));
+#endif
     txn_man->hashSize = txn_man->hash.length();
 
     breq->copy_from_txn(txn_man);
@@ -2343,7 +2417,11 @@ void WorkerThread::set_txn_man_fields(HOTSTUFFProposalMsg *prop, uint64_t bid)
         txn_man->instance_id = instance_id;
         // Fields that need to updated according to the specific algorithm.
         algorithm_specific_update(prop, i);
+#if SOA_BATCH
+        init_txn_man(prop->reqs, i);
+#else
         init_txn_man(prop->requestMsg[i]);
+#endif
         bool ready = txn_man->set_ready();
         assert(ready);
     }
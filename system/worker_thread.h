@@ -47,6 +47,9 @@ public:
 #else
     void init_txn_man(YCSBClientQueryMessage *msg);
 #endif
+#if SOA_BATCH
+    void init_txn_man(RequestColumns &reqs, uint64_t i);
+#endif
 #if EXECUTION_THREAD
     void send_execute_msg();
     RC process_execute_msg(Message *msg);
@@ -13,6 +13,7 @@
 #include "message.h"
 #include "timer.h"
 #include "chain.h"
+#include "erasure_code.h"
 
 #if CONSENSUS == HOTSTUFF
 /**
@@ -46,8 +47,12 @@ void WorkerThread::create_and_send_hotstuff_prepare(ClientQueryBatch *msg, uint6
     // Starting index for this batch of transactions.
     next_set = tid;
 
+#if BINARY_DIGEST
+    BatchDigest digest;
+#else
     // String of transactions in a batch to generate hash.
     string batchStr;
+#endif
 #if SEPARATE
     uint64_t view = get_last_sent_view(instance_id);
 #endif
@@ -71,13 +76,31 @@ void WorkerThread::create_and_send_hotstuff_prepare(ClientQueryBatch *msg, uint6
         // Fields that need to updated according to the specific algorithm.
         algorithm_specific_update(msg, i);
 
+#if SOA_BATCH
+        init_txn_man(msg->reqs, i);
+
+#if BINARY_DIGEST
+        digest.add(msg->reqs, i);
+#else
+        // Append string representation of this txn.
+        batchStr += msg->reqs.getString(i);
+#endif
+
+        // Setting up data for HOTSTUFFProposalMsg Message.
+        prep->copy_from_txn(txn_man, msg->reqs, i);
+#else
         init_txn_man(msg->cqrySet[i]);
 
+#if BINARY_DIGEST
+        digest.add(msg->cqrySet[i]);
+#else
         // Append string representation of this txn.
         batchStr += msg->cqrySet[i]->getString();
+#endif
 
         // Setting up data for HOTSTUFFPrepareMsg Message.
         prep->copy_from_txn(txn_man, msg->cqrySet[i]);
+#endif
 
         // Reset this txn manager.
         bool ready = txn_man->set_ready();
@@ -88,7 +111,11 @@ void WorkerThread::create_and_send_hotstuff_prepare(ClientQueryBatch *msg, uint6
     unset_ready_txn(txn_man);
 
     // Generating the hash representing the whole batch in last txn man.
+#if BINARY_DIGEST
+    txn_man->set_hash(digest.get_hash());
+#else
     txn_man->set_hash(calculateHash(batchStr));
+#endif
     assert(!txn_man->get_hash().empty());
 
 #if CHAINED
@@ -106,6 +133,9 @@ void WorkerThread::create_and_send_hotstuff_prepare(ClientQueryBatch *msg, uint6
     txn_man->hashSize = txn_man->hash.length();
 
     prep->copy_from_txn(txn_man);
+#if TREE_DISSEMINATION
+    prep->sign_leader();
+#endif
 
 // #if !SEPARATE
 //     #if !PVP
@@ -138,9 +168,18 @@ void WorkerThread::create_and_send_hotstuff_prepare(ClientQueryBatch *msg, uint6
     #endif
 #endif
     // Send the HOTSTUFFPrepareMsg message to all the other replicas.
+#if EC_DISSEMINATION
+    send_proposal_chunks(get_thd_id(), prep);
+#else
+#if TREE_DISSEMINATION
+    // Only the leader's children; the rest is reached through the tree.
+    vector<uint64_t> dest = tree_children(g_node_id, g_node_id);
+#else
     vector<uint64_t> dest = nodes_to_send(0, g_node_cnt);
+#endif
     msg_queue.enqueue(get_thd_id(), prep, dest);
     dest.clear();
+#endif
     #if PROPOSAL_THREAD
     // inc_incomplete_proposal_cnt(instance_id);
     #endif
@@ -167,7 +206,11 @@ RC WorkerThread::process_client_batch_hotstuff(Message *msg)
     ClientQueryBatch *clbtch = (ClientQueryBatch *)msg;
     
     #if PROCESS_PRINT
+#if SOA_BATCH
+    printf("ClientQueryBatch: %ld, THD: %ld :: CL: %ld :: RQ: %ld  %f\n", msg->txn_id, get_thd_id(), msg->return_node_id, clbtch->reqs.keys[0], simulation->seconds_from_start(get_sys_clock()));
+#else
     printf("ClientQueryBatch: %ld, THD: %ld :: CL: %ld :: RQ: %ld  %f\n", msg->txn_id, get_thd_id(), msg->return_node_id, clbtch->cqrySet[0]->requests[0]->key, simulation->seconds_from_start(get_sys_clock()));
+#endif
     fflush(stdout);
     #endif
 
@@ -1044,6 +1087,19 @@ RC WorkerThread::process_hotstuff_proposal(Message *msg){
     // Check if the message is valid.
 #if ENABLE_ENCRYPT
     validate_msg(prop);
+#endif
+#if TREE_DISSEMINATION
+    // Pass the proposal on to this replica's subtree. It was checked to come
+    // from the tree parent and to carry the leader's signature over its
+    // digest, so a forwarder cannot alter the batch.
+    vector<uint64_t> children = tree_children(get_view_primary(prop->view, instance_id), g_node_id);
+    if (!children.empty())
+    {
+        char *buf = create_msg_buffer(prop);
+        Message *fwd = deep_copy_msg(buf, prop);
+        delete_msg_buffer(buf);
+        msg_queue.enqueue(get_thd_id(), fwd, children);
+    }
 #endif
     // Allocate transaction managers for all the transactions in the batch.
     set_txn_man_fields(prop, 0);
@@ -31,7 +31,11 @@ RC WorkerThread::process_client_batch(Message *msg)
     ClientQueryBatch *clbtch = (ClientQueryBatch *)msg;
 
     #if PROCESS_PRINT
+#if SOA_BATCH
+    printf("ClientQueryBatch: %ld, THD: %ld :: CL: %ld :: RQ: %ld\n", msg->txn_id, get_thd_id(), msg->return_node_id, clbtch->reqs.keys[0]);
+#else
     printf("ClientQueryBatch: %ld, THD: %ld :: CL: %ld :: RQ: %ld\n", msg->txn_id, get_thd_id(), msg->return_node_id, clbtch->cqrySet[0]->requests[0]->key);
+#endif
     fflush(stdout);
     #endif
 
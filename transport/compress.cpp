@@ -0,0 +1,132 @@
+#include "compress.h"
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 0xFFFF
+
+static inline uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Lengths past a nibble go on in bytes of 255 closed by a smaller one.
+static inline bool lz_put_len(char *dst, uint64_t &op, uint64_t dst_cap, uint64_t len)
+{
+    while (len >= 255)
+    {
+        if (op >= dst_cap)
+            return false;
+        dst[op++] = (char)255;
+        len -= 255;
+    }
+    if (op >= dst_cap)
+        return false;
+    dst[op++] = (char)len;
+    return true;
+}
+
+static inline bool lz_get_len(const char *src, uint64_t &ip, uint64_t src_len, uint64_t &len)
+{
+    uint8_t b;
+    do
+    {
+        if (ip >= src_len)
+            return false;
+        b = (uint8_t)src[ip++];
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+// Emits one sequence; a match length of 0 marks the closing literals.
+static bool lz_put_seq(char *dst, uint64_t &op, uint64_t dst_cap, const char *lit, uint64_t lit_len, uint64_t offset, uint64_t match_len)
+{
+    uint64_t mcode = match_len ? match_len - LZ_MIN_MATCH : 0;
+    if (op >= dst_cap)
+        return false;
+    dst[op++] = (char)(((lit_len < 15 ? lit_len : 15) << 4) | (mcode < 15 ? mcode : 15));
+    if (lit_len >= 15 && !lz_put_len(dst, op, dst_cap, lit_len - 15))
+        return false;
+    if (op + lit_len > dst_cap)
+        return false;
+    memcpy(dst + op, lit, lit_len);
+    op += lit_len;
+    if (match_len == 0)
+        return true;
+    if (op + 2 > dst_cap)
+        return false;
+    dst[op++] = (char)(offset & 0xFF);
+    dst[op++] = (char)(offset >> 8);
+    if (mcode >= 15 && !lz_put_len(dst, op, dst_cap, mcode - 15))
+        return false;
+    return true;
+}
+
+uint64_t lz_compress(const char *src, uint64_t src_len, char *dst, uint64_t dst_cap)
+{
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+    uint64_t ip = 0;
+    uint64_t anchor = 0;
+    uint64_t op = 0;
+    while (ip + LZ_MIN_MATCH <= src_len)
+    {
+        uint32_t seq;
+        memcpy(&seq, src + ip, sizeof(seq));
+        uint32_t h = lz_hash(seq);
+        uint64_t ref = table[h];
+        table[h] = ip;
+        if (ref >= ip || ip - ref > LZ_MAX_OFFSET || memcmp(src + ref, src + ip, LZ_MIN_MATCH) != 0)
+        {
+            ip++;
+            continue;
+        }
+        uint64_t match_len = LZ_MIN_MATCH;
+        while (ip + match_len < src_len && src[ref + match_len] == src[ip + match_len])
+            match_len++;
+        if (!lz_put_seq(dst, op, dst_cap, src + anchor, ip - anchor, ip - ref, match_len))
+            return 0;
+        ip += match_len;
+        anchor = ip;
+    }
+    if (anchor < src_len && !lz_put_seq(dst, op, dst_cap, src + anchor, src_len - anchor, 0, 0))
+        return 0;
+    return op < dst_cap ? op : 0;
+}
+
+bool lz_decompress(const char *src, uint64_t src_len, char *dst, uint64_t dst_len)
+{
+    uint64_t ip = 0;
+    uint64_t op = 0;
+    while (ip < src_len)
+    {
+        uint8_t token = (uint8_t)src[ip++];
+        uint64_t lit_len = token >> 4;
+        if (lit_len == 15 && !lz_get_len(src, ip, src_len, lit_len))
+            return false;
+        if (ip + lit_len > src_len || op + lit_len > dst_len)
+            return false;
+        memcpy(dst + op, src + ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+        if (ip == src_len)
+            break;
+
+        if (ip + 2 > src_len)
+            return false;
+        uint64_t offset = (uint8_t)src[ip] | ((uint64_t)(uint8_t)src[ip + 1] << 8);
+        ip += 2;
+        uint64_t match_len = token & 0xF;
+        if (match_len == 15 && !lz_get_len(src, ip, src_len, match_len))
+            return false;
+        match_len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || op + match_len > dst_len)
+            return false;
+        // Matches may overlap the bytes they produce.
+        const char *ref = dst + op - offset;
+        for (uint64_t i = 0; i < match_len; i++)
+            dst[op + i] = ref[i];
+        op += match_len;
+    }
+    return op == dst_len;
+}
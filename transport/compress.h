@@ -0,0 +1,21 @@
+#ifndef _COMPRESS_H_
+#define _COMPRESS_H_
+
+#include "global.h"
+
+/*
+    Byte-oriented LZ codec in the style of an LZ4 block: sequences of a token
+    (literal run, match length), the literals and a 16-bit match offset. It
+    suits frames of client requests, which repeat client ids, timestamps and
+    small keys from one request to the next.
+*/
+
+// Compresses src into dst, which holds dst_cap bytes. Returns the compressed
+// size, or 0 if the result would not be smaller than dst_cap.
+uint64_t lz_compress(const char *src, uint64_t src_len, char *dst, uint64_t dst_cap);
+
+// Decompresses src into dst, which holds exactly dst_len bytes. Returns false
+// if src is malformed or does not decode to dst_len bytes.
+bool lz_decompress(const char *src, uint64_t src_len, char *dst, uint64_t dst_len);
+
+#endif
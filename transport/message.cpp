@@ -8,8 +8,13 @@
 #include <fstream>
 #include <ctime>
 #include <string>
+#if MERKLE_DIGEST
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#endif
 
-std::vector<Message *> *Message::create_messages(char *buf)
+std::vector<Message *> *Message::create_messages(char *buf, uint64_t size)
 {
 	std::vector<Message *> *all_msgs = new std::vector<Message *>;
 	char *data = buf;
@@ -23,10 +28,39 @@ std::vector<Message *> *Message::create_messages(char *buf)
 	assert(dest_id == g_node_id);
 	assert(return_id != g_node_id);
 	assert(ISCLIENTN(return_id) || ISSERVERN(return_id) || ISREPLICAN(return_id));
+#if VOTE_BUNDLE
+	bool frame_auth = false;
+	if (txn_cnt & VOTE_BUNDLE_FLAG)
+	{
+		// Frame of bundled votes: [frame][mac][mac size].
+		// A frame that fails the bounds or the MAC is dropped whole.
+		uint32_t mac_size = 0;
+		if (size >= ptr + sizeof(mac_size))
+			memcpy(&mac_size, &data[size - sizeof(mac_size)], sizeof(mac_size));
+		if (size < ptr + sizeof(mac_size) || mac_size == 0 || mac_size > size - ptr - sizeof(mac_size))
+		{
+			assert(0);
+			return all_msgs;
+		}
+		uint64_t frame_size = size - sizeof(mac_size) - mac_size;
+		string frame(data, frame_size);
+		string mac(&data[frame_size], mac_size);
+		if (!CmacVerifyString(cmacOthersKeys[return_id], frame, mac))
+		{
+			assert(0);
+			return all_msgs;
+		}
+		frame_auth = true;
+		txn_cnt &= ~VOTE_BUNDLE_FLAG;
+	}
+#endif
 	while (txn_cnt > 0)
 	{
 		Message *msg = create_message(&data[ptr]);
 		msg->return_node_id = return_id;
+#if VOTE_BUNDLE
+		msg->frame_auth = frame_auth;
+#endif
 		ptr += msg->get_size();
 		all_msgs->push_back(msg);
 		--txn_cnt;
@@ -49,14 +83,17 @@ Message *Message::create_message(TxnManager *txn, RemReqType rtype)
 	Message *msg = create_message(rtype);
 	msg->mcopy_from_txn(txn);
 	msg->copy_from_txn(txn);
+#if STATS_ENABLE
 	// copy latency here
-	msg->lat_work_queue_time = txn->txn_stats.work_queue_time_short;
-	msg->lat_msg_queue_time = txn->txn_stats.msg_queue_time_short;
-	msg->lat_cc_block_time = txn->txn_stats.cc_block_time_short;
-	msg->lat_cc_time = txn->txn_stats.cc_time_short;
-	msg->lat_process_time = txn->txn_stats.process_time_short;
-	msg->lat_network_time = txn->txn_stats.lat_network_time_start;
-	msg->lat_other_time = txn->txn_stats.lat_other_time_start;
+	MsgStats *lat = msg->get_lat();
+	lat->lat_work_queue_time = txn->txn_stats.work_queue_time_short;
+	lat->lat_msg_queue_time = txn->txn_stats.msg_queue_time_short;
+	lat->lat_cc_block_time = txn->txn_stats.cc_block_time_short;
+	lat->lat_cc_time = txn->txn_stats.cc_time_short;
+	lat->lat_process_time = txn->txn_stats.process_time_short;
+	lat->lat_network_time = txn->txn_stats.lat_network_time_start;
+	lat->lat_other_time = txn->txn_stats.lat_other_time_start;
+#endif
 
 	return msg;
 }
@@ -197,6 +234,11 @@ Message *Message::create_message(RemReqType rtype)
 		msg = new HOTSTUFFProposalMsg;
 		break;
 #endif
+#if EC_DISSEMINATION
+	case HOTSTUFF_CHUNK_MSG:
+		msg = new HOTSTUFFChunkMsg;
+		break;
+#endif
 #endif
 	default:
 		cout << "FALSE TYPE: " << rtype << "\n";
@@ -210,15 +252,6 @@ Message *Message::create_message(RemReqType rtype)
 	msg->return_node_id = g_node_id;
 	msg->wq_time = 0;
 	msg->mq_time = 0;
-	msg->ntwk_time = 0;
-
-	msg->lat_work_queue_time = 0;
-	msg->lat_msg_queue_time = 0;
-	msg->lat_cc_block_time = 0;
-	msg->lat_cc_time = 0;
-	msg->lat_process_time = 0;
-	msg->lat_network_time = 0;
-	msg->lat_other_time = 0;
 
 	return msg;
 }
@@ -226,6 +259,21 @@ Message *Message::create_message(RemReqType rtype)
 uint64_t Message::mget_size()
 {
 	uint64_t size = 0;
+#if COMPACT_WIRE
+	size += sizeof(RemReqType);
+	size += sizeof(uint8_t);
+	size += varint_size(txn_id);
+	size += varint_size(instance_id);
+	size += varint_size(sigSize);
+	size += varint_size(keySize);
+	size += signature.size();
+	size += pubKey.size();
+	if (COMPACT_WIRE_STATS && has_lat)
+	{
+		// mq_time and the latency stats
+		size += sizeof(uint64_t) * 8;
+	}
+#else
 	size += sizeof(RemReqType);
 	size += sizeof(uint64_t);
 
@@ -238,6 +286,7 @@ uint64_t Message::mget_size()
 	size += sizeof(instance_id);
 	// for stats, latency
 	size += sizeof(uint64_t) * 7;
+#endif
 
 #if SHARPER
 	size += sizeof(is_cross_shard);
@@ -261,25 +310,28 @@ void Message::mcopy_from_buf(char *buf)
 {
 	uint64_t ptr = 0;
 	COPY_VAL(rtype, buf, ptr);
+#if COMPACT_WIRE
+	// Wire version in the high nibble, WIRE_* flags below.
+	uint8_t wire_hdr;
+	COPY_VAL(wire_hdr, buf, ptr);
+	assert((wire_hdr >> 4) == COMPACT_WIRE_VERSION);
+	COPY_VARINT(txn_id, buf, ptr);
+	COPY_VARINT(instance_id, buf, ptr);
+	COPY_VARINT(sigSize, buf, ptr);
+	COPY_VARINT(keySize, buf, ptr);
+	signature.assign(&buf[ptr], sigSize);
+	ptr += sigSize;
+	pubKey.assign(&buf[ptr], keySize);
+	ptr += keySize;
+	if (wire_hdr & WIRE_STATS)
+	{
+		COPY_VAL(mq_time, buf, ptr);
+		ptr = lat_from_buf(buf, ptr);
+	}
+#else
 	COPY_VAL(txn_id, buf, ptr);
 	COPY_VAL(mq_time, buf, ptr);
-
-	COPY_VAL(lat_work_queue_time, buf, ptr);
-	COPY_VAL(lat_msg_queue_time, buf, ptr);
-	COPY_VAL(lat_cc_block_time, buf, ptr);
-	COPY_VAL(lat_cc_time, buf, ptr);
-	COPY_VAL(lat_process_time, buf, ptr);
-	COPY_VAL(lat_network_time, buf, ptr);
-	COPY_VAL(lat_other_time, buf, ptr);
-	if (IS_LOCAL(txn_id))
-	{
-		lat_network_time = (get_sys_clock() - lat_network_time) - lat_other_time;
-	}
-	else
-	{
-		lat_other_time = get_sys_clock();
-	}
-	//printf("buftot %ld: %f, %f\n",txn_id,lat_network_time,lat_other_time);
+	ptr = lat_from_buf(buf, ptr);
 
 	COPY_VAL(sigSize, buf, ptr);
 	COPY_VAL(keySize, buf, ptr);
@@ -299,6 +351,7 @@ void Message::mcopy_from_buf(char *buf)
 		COPY_VAL(v, buf, ptr);
 		pubKey += v;
 	}
+#endif
 
 #if SHARPER
 	COPY_VAL(is_cross_shard, buf, ptr);
@@ -309,19 +362,28 @@ void Message::mcopy_to_buf(char *buf)
 {
 	uint64_t ptr = 0;
 	COPY_BUF(buf, rtype, ptr);
+#if COMPACT_WIRE
+	uint8_t wire_hdr = COMPACT_WIRE_VERSION << 4;
+	if (COMPACT_WIRE_STATS && has_lat)
+		wire_hdr |= WIRE_STATS;
+	COPY_BUF(buf, wire_hdr, ptr);
+	COPY_BUF_VARINT(buf, txn_id, ptr);
+	COPY_BUF_VARINT(buf, instance_id, ptr);
+	COPY_BUF_VARINT(buf, sigSize, ptr);
+	COPY_BUF_VARINT(buf, keySize, ptr);
+	memcpy(&buf[ptr], signature.data(), sigSize);
+	ptr += sigSize;
+	memcpy(&buf[ptr], pubKey.data(), keySize);
+	ptr += keySize;
+	if (wire_hdr & WIRE_STATS)
+	{
+		COPY_BUF(buf, mq_time, ptr);
+		ptr = lat_to_buf(buf, ptr);
+	}
+#else
 	COPY_BUF(buf, txn_id, ptr);
 	COPY_BUF(buf, mq_time, ptr);
-
-	COPY_BUF(buf, lat_work_queue_time, ptr);
-	COPY_BUF(buf, lat_msg_queue_time, ptr);
-	COPY_BUF(buf, lat_cc_block_time, ptr);
-	COPY_BUF(buf, lat_cc_time, ptr);
-	COPY_BUF(buf, lat_process_time, ptr);
-	lat_network_time = get_sys_clock();
-
-	//printf("mtobuf %ld: %f, %f\n",txn_id,lat_network_time,lat_other_time);
-	COPY_BUF(buf, lat_network_time, ptr);
-	COPY_BUF(buf, lat_other_time, ptr);
+	ptr = lat_to_buf(buf, ptr);
 
 	COPY_BUF(buf, sigSize, ptr);
 	COPY_BUF(buf, keySize, ptr);
@@ -338,11 +400,63 @@ void Message::mcopy_to_buf(char *buf)
 		v = pubKey[j];
 		COPY_BUF(buf, v, ptr);
 	}
+#endif
 #if SHARPER
 	COPY_BUF(buf, is_cross_shard, ptr);
 #endif
 }
 
+// Messages without stats send zeros, which the receiver leaves unset.
+uint64_t Message::lat_to_buf(char *buf, uint64_t ptr)
+{
+	MsgStats none;
+	MsgStats *l = &none;
+#if STATS_ENABLE
+	if (has_lat)
+	{
+		lat.lat_network_time = get_sys_clock();
+		l = &lat;
+	}
+#endif
+
+	COPY_BUF(buf, l->lat_work_queue_time, ptr);
+	COPY_BUF(buf, l->lat_msg_queue_time, ptr);
+	COPY_BUF(buf, l->lat_cc_block_time, ptr);
+	COPY_BUF(buf, l->lat_cc_time, ptr);
+	COPY_BUF(buf, l->lat_process_time, ptr);
+	COPY_BUF(buf, l->lat_network_time, ptr);
+	COPY_BUF(buf, l->lat_other_time, ptr);
+	return ptr;
+}
+
+uint64_t Message::lat_from_buf(char *buf, uint64_t ptr)
+{
+	MsgStats l;
+	COPY_VAL(l.lat_work_queue_time, buf, ptr);
+	COPY_VAL(l.lat_msg_queue_time, buf, ptr);
+	COPY_VAL(l.lat_cc_block_time, buf, ptr);
+	COPY_VAL(l.lat_cc_time, buf, ptr);
+	COPY_VAL(l.lat_process_time, buf, ptr);
+	COPY_VAL(l.lat_network_time, buf, ptr);
+	COPY_VAL(l.lat_other_time, buf, ptr);
+	// The sender stamps the network time only when it had stats.
+	if (l.lat_network_time == 0)
+		return ptr;
+
+#if STATS_ENABLE
+	*get_lat() = l;
+	if (IS_LOCAL(txn_id))
+	{
+		lat.lat_network_time = (get_sys_clock() - lat.lat_network_time) - lat.lat_other_time;
+	}
+	else
+	{
+		lat.lat_other_time = get_sys_clock();
+	}
+#endif
+	return ptr;
+}
+
 void Message::release_message(Message *msg, uint64_t pos)
 {
 	switch (msg->rtype)
@@ -559,6 +673,14 @@ void Message::release_message(Message *msg, uint64_t pos)
 		break;
 	}
 #endif
+#if EC_DISSEMINATION
+	case HOTSTUFF_CHUNK_MSG:{
+		HOTSTUFFChunkMsg *m_msg = (HOTSTUFFChunkMsg *)msg;
+		m_msg->release();
+		delete m_msg;
+		break;
+	}
+#endif
 #endif
 
 	default:
@@ -1332,6 +1454,327 @@ void KeyExchange::copy_to_buf(char *buf)
 #endif
 }
 
+#if SOA_BATCH
+void RequestColumns::init(uint64_t query_cnt)
+{
+	release();
+	reqs_per_query = g_req_per_query;
+	keys.reserve(query_cnt * reqs_per_query);
+	values.reserve(query_cnt * reqs_per_query);
+	client_ts.reserve(query_cnt);
+	return_node.reserve(query_cnt);
+}
+
+void RequestColumns::release()
+{
+	keys.clear();
+	values.clear();
+	client_ts.clear();
+	return_node.clear();
+}
+
+void RequestColumns::add(YCSBClientQueryMessage *clqry)
+{
+	assert(clqry->requests.size() == reqs_per_query);
+	for (uint64_t i = 0; i < clqry->requests.size(); i++)
+	{
+		keys.push_back(clqry->requests[i]->key);
+		values.push_back(clqry->requests[i]->value);
+	}
+	client_ts.push_back(clqry->client_startts);
+	return_node.push_back(clqry->return_node);
+}
+
+void RequestColumns::add(RequestColumns &src, uint64_t i)
+{
+	assert(src.reqs_per_query == reqs_per_query);
+	uint64_t start = i * reqs_per_query;
+	keys.insert(keys.end(), src.keys.begin() + start, src.keys.begin() + start + reqs_per_query);
+	values.insert(values.end(), src.values.begin() + start, src.values.begin() + start + reqs_per_query);
+	client_ts.push_back(src.client_ts[i]);
+	return_node.push_back(src.return_node[i]);
+}
+
+YCSBClientQueryMessage *RequestColumns::get_query(uint64_t i)
+{
+	YCSBClientQueryMessage *clqry = (YCSBClientQueryMessage *)Message::create_message(CL_QRY);
+	clqry->requests.init(reqs_per_query);
+	for (uint64_t j = i * reqs_per_query; j < (i + 1) * reqs_per_query; j++)
+	{
+		ycsb_request *req = (ycsb_request *)mem_allocator.alloc(sizeof(ycsb_request));
+		req->key = keys[j];
+		req->value = values[j];
+		clqry->requests.add(req);
+	}
+	clqry->client_startts = client_ts[i];
+	clqry->return_node = return_node[i];
+	return clqry;
+}
+
+uint64_t RequestColumns::get_size()
+{
+	uint64_t size = sizeof(uint64_t) * 2;
+	size += sizeof(uint64_t) * (keys.size() + values.size());
+	size += sizeof(uint64_t) * (client_ts.size() + return_node.size());
+	return size;
+}
+
+uint64_t RequestColumns::copy_from_buf(char *buf, uint64_t ptr)
+{
+	uint64_t query_cnt;
+	COPY_VAL(query_cnt, buf, ptr);
+	COPY_VAL(reqs_per_query, buf, ptr);
+	uint64_t req_cnt = query_cnt * reqs_per_query;
+	keys.resize(req_cnt);
+	values.resize(req_cnt);
+	client_ts.resize(query_cnt);
+	return_node.resize(query_cnt);
+	memcpy(keys.data(), &buf[ptr], sizeof(uint64_t) * req_cnt);
+	ptr += sizeof(uint64_t) * req_cnt;
+	memcpy(values.data(), &buf[ptr], sizeof(uint64_t) * req_cnt);
+	ptr += sizeof(uint64_t) * req_cnt;
+	memcpy(client_ts.data(), &buf[ptr], sizeof(uint64_t) * query_cnt);
+	ptr += sizeof(uint64_t) * query_cnt;
+	memcpy(return_node.data(), &buf[ptr], sizeof(uint64_t) * query_cnt);
+	ptr += sizeof(uint64_t) * query_cnt;
+	return ptr;
+}
+
+uint64_t RequestColumns::copy_to_buf(char *buf, uint64_t ptr)
+{
+	uint64_t query_cnt = size();
+	COPY_BUF(buf, query_cnt, ptr);
+	COPY_BUF(buf, reqs_per_query, ptr);
+	memcpy(&buf[ptr], keys.data(), sizeof(uint64_t) * keys.size());
+	ptr += sizeof(uint64_t) * keys.size();
+	memcpy(&buf[ptr], values.data(), sizeof(uint64_t) * values.size());
+	ptr += sizeof(uint64_t) * values.size();
+	memcpy(&buf[ptr], client_ts.data(), sizeof(uint64_t) * query_cnt);
+	ptr += sizeof(uint64_t) * query_cnt;
+	memcpy(&buf[ptr], return_node.data(), sizeof(uint64_t) * query_cnt);
+	ptr += sizeof(uint64_t) * query_cnt;
+	return ptr;
+}
+
+string RequestColumns::getRequestString(uint64_t i)
+{
+	string message;
+	for (uint64_t j = i * reqs_per_query; j < (i + 1) * reqs_per_query; j++)
+	{
+		message += std::to_string(keys[j]);
+		message += " ";
+		message += values[j];
+		message += " ";
+	}
+
+	return message;
+}
+
+string RequestColumns::getString(uint64_t i)
+{
+	string message = getRequestString(i);
+	message += " ";
+	message += to_string(client_ts[i]);
+
+	return message;
+}
+#endif
+
+#if BINARY_DIGEST
+void BatchDigest::add(YCSBClientQueryMessage *clqry)
+{
+	start_leaf();
+	add(clqry->requests.size());
+	for (uint64_t i = 0; i < clqry->requests.size(); i++)
+		add(clqry->requests[i]->key);
+	for (uint64_t i = 0; i < clqry->requests.size(); i++)
+		add(clqry->requests[i]->value);
+	add(clqry->client_startts);
+	add(clqry->return_node);
+}
+
+#if SOA_BATCH
+// Same bytes as for the query message, a column slice at a time.
+void BatchDigest::add(RequestColumns &reqs, uint64_t i)
+{
+	uint64_t start = i * reqs.reqs_per_query;
+	start_leaf();
+	add(reqs.reqs_per_query);
+	add(&reqs.keys[start], reqs.reqs_per_query);
+	add(&reqs.values[start], reqs.reqs_per_query);
+	add(reqs.client_ts[i]);
+	add(reqs.return_node[i]);
+}
+#endif
+
+#if MERKLE_DIGEST
+/*
+	Leaves and inner nodes are hashed behind a 0 and a 1 byte respectively, so
+	a leaf cannot pass for an inner node. A node without a sibling moves up a
+	level unchanged.
+*/
+static string merkle_hash(byte tag, const byte *data, uint64_t len, const byte *data2 = NULL, uint64_t len2 = 0)
+{
+	byte aDigest[CryptoPP::SHA256::DIGESTSIZE];
+	CryptoPP::SHA256 sha;
+	sha.Update(&tag, 1);
+	sha.Update(data, len);
+	if (data2)
+		sha.Update(data2, len2);
+	sha.Final(aDigest);
+	return string((char *)aDigest, CryptoPP::SHA256::DIGESTSIZE);
+}
+
+static string merkle_parent(const string &left, const string &right)
+{
+	return merkle_hash(1, (const byte *)left.data(), left.size(), (const byte *)right.data(), right.size());
+}
+
+string BatchDigest::hash_leaf(const uint64_t *vals, uint64_t cnt)
+{
+	return merkle_hash(0, (const byte *)vals, sizeof(uint64_t) * cnt);
+}
+
+void BatchDigest::hash_leaves(uint64_t from, uint64_t to)
+{
+	for (uint64_t i = from; i < to; i++)
+	{
+		uint64_t end = i + 1 < leaf_start.size() ? leaf_start[i + 1] : words.size();
+		levels[0][i] = hash_leaf(&words[leaf_start[i]], end - leaf_start[i]);
+	}
+}
+
+/*
+	MERKLE_THREADS - 1 helper threads take slices of leaves off a queue shared
+	by all digests. They are started on first use and never exit. The pool is
+	never freed, so that they do not outlive it at exit.
+*/
+struct BatchDigest::SlicePool
+{
+	std::mutex lock;
+	std::condition_variable ready;
+	std::deque<LeafSlice> slices;
+};
+
+BatchDigest::SlicePool *BatchDigest::pool = NULL;
+
+void BatchDigest::start_pool()
+{
+	pool = new SlicePool;
+	for (uint64_t i = 1; i < MERKLE_THREADS; i++)
+	{
+		std::thread([] {
+			while (true)
+				run_slice(true);
+		}).detach();
+	}
+}
+
+// Hashes one queued slice. Without wait, returns false if there is none.
+bool BatchDigest::run_slice(bool wait)
+{
+	std::unique_lock<std::mutex> guard(pool->lock);
+	if (wait)
+		pool->ready.wait(guard, [] { return !pool->slices.empty(); });
+	if (pool->slices.empty())
+		return false;
+	LeafSlice slice = pool->slices.front();
+	pool->slices.pop_front();
+	guard.unlock();
+	slice.digest->hash_leaves(slice.from, slice.to);
+	slice.left->fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+string BatchDigest::get_hash()
+{
+	uint64_t leaf_cnt = leaf_start.size();
+	levels.assign(1, vector<string>(leaf_cnt));
+	if (leaf_cnt == 0)
+		return hash_leaf(NULL, 0);
+
+	// Leaves are independent, so those of large batches are split into
+	// slices. The caller hashes the first one and then works on queued
+	// slices, its own or another digest's, until its own are all done.
+	if (MERKLE_THREADS > 1 && leaf_cnt >= MERKLE_PARALLEL_MIN)
+	{
+		static std::once_flag started;
+		std::call_once(started, start_pool);
+		uint64_t per_slice = (leaf_cnt + MERKLE_THREADS - 1) / MERKLE_THREADS;
+		std::atomic<uint64_t> left(0);
+		pool->lock.lock();
+		for (uint64_t from = per_slice; from < leaf_cnt; from += per_slice)
+		{
+			LeafSlice slice = {this, from, std::min(from + per_slice, leaf_cnt), &left};
+			pool->slices.push_back(slice);
+			left++;
+		}
+		pool->lock.unlock();
+		pool->ready.notify_all();
+		hash_leaves(0, per_slice);
+		while (left.load(std::memory_order_acquire) > 0)
+		{
+			if (!run_slice(false))
+				std::this_thread::yield();
+		}
+	}
+	else
+	{
+		hash_leaves(0, leaf_cnt);
+	}
+
+	while (levels.back().size() > 1)
+	{
+		vector<string> &below = levels.back();
+		vector<string> above;
+		for (uint64_t i = 0; i + 1 < below.size(); i += 2)
+			above.push_back(merkle_parent(below[i], below[i + 1]));
+		if (below.size() % 2)
+			above.push_back(below.back());
+		levels.push_back(above);
+	}
+	return levels.back()[0];
+}
+
+vector<string> BatchDigest::get_proof(uint64_t i)
+{
+	assert(!levels.empty() && i < levels[0].size());
+	vector<string> proof;
+	for (uint64_t l = 0; l + 1 < levels.size(); l++, i /= 2)
+	{
+		if ((i ^ 1) < levels[l].size())
+			proof.push_back(levels[l][i ^ 1]);
+	}
+	return proof;
+}
+
+// Whether leaf i of leaf_cnt leaves, with the siblings in proof, yields root.
+bool BatchDigest::verify_proof(const string &leaf, uint64_t i, uint64_t leaf_cnt,
+							   const vector<string> &proof, const string &root)
+{
+	string node = leaf;
+	uint64_t next = 0;
+	for (uint64_t cnt = leaf_cnt; cnt > 1; cnt = (cnt + 1) / 2, i /= 2)
+	{
+		if ((i ^ 1) >= cnt)
+			continue;
+		if (next == proof.size())
+			return false;
+		node = i % 2 ? merkle_parent(proof[next], node) : merkle_parent(node, proof[next]);
+		next++;
+	}
+	return next == proof.size() && node == root;
+}
+#else
+string BatchDigest::get_hash()
+{
+	byte aDigest[CryptoPP::SHA256::DIGESTSIZE];
+	sha.Final(aDigest);
+	return string((char *)aDigest, CryptoPP::SHA256::DIGESTSIZE);
+}
+#endif
+#endif
+
 #if CLIENT_BATCH
 
 uint64_t ClientQueryBatch::get_size()
@@ -1344,10 +1787,14 @@ uint64_t ClientQueryBatch::get_size()
 	size += sizeof(bool) * (g_shard_cnt);
 #endif
 
+#if SOA_BATCH
+	size += reqs.get_size();
+#else
 	for (uint i = 0; i < get_batch_size(); i++)
 	{
 		size += cqrySet[i]->get_size();
 	}
+#endif
 
 #if RING_BFT
 	size += sizeof(is_cross_shard);
@@ -1360,16 +1807,24 @@ void ClientQueryBatch::init()
 {
 	this->return_node = g_node_id;
 	this->batch_size = get_batch_size();
+#if SOA_BATCH
+	this->reqs.init(get_batch_size());
+#else
 	this->cqrySet.init(get_batch_size());
+#endif
 }
 
 void ClientQueryBatch::release()
 {
+#if SOA_BATCH
+	reqs.release();
+#else
 	for (uint64_t i = 0; i < get_batch_size(); i++)
 	{
 		Message::release_message(cqrySet[i]);
 	}
 	cqrySet.release();
+#endif
 }
 
 void ClientQueryBatch::copy_from_txn(TxnManager *txn)
@@ -1396,7 +1851,11 @@ void ClientQueryBatch::copy_from_buf(char *buf)
 		COPY_VAL(involved_shards[i], buf, ptr);
 	}
 #endif
-	
+
+#if SOA_BATCH
+	ptr = reqs.copy_from_buf(buf, ptr);
+	assert(reqs.size() == get_batch_size());
+#else
 	for (uint64_t i = 0; i < cqrySet.size(); i++)
     {
         Message::release_message(cqrySet[i]);
@@ -1414,6 +1873,7 @@ void ClientQueryBatch::copy_from_buf(char *buf)
 		cqrySet.add((YCSBClientQueryMessage *)msg);
 #endif
 	}
+#endif
 
 #if RING_BFT
 	for (uint64_t i = 0; i < g_shard_cnt; i++)
@@ -1439,11 +1899,15 @@ void ClientQueryBatch::copy_to_buf(char *buf)
 		COPY_BUF(buf, involved_shards[i], ptr);
 	}
 #endif
+#if SOA_BATCH
+	ptr = reqs.copy_to_buf(buf, ptr);
+#else
 	for (uint i = 0; i < get_batch_size(); i++)
 	{
 		cqrySet[i]->copy_to_buf(&buf[ptr]);
 		ptr += cqrySet[i]->get_size();
 	}
+#endif
 
 #if RING_BFT
 	for (uint64_t i = 0; i < g_shard_cnt; i++)
@@ -1460,7 +1924,11 @@ string ClientQueryBatch::getString()
 	string message = std::to_string(this->return_node);
 	for (int i = 0; i < BATCH_SIZE; i++)
 	{
+#if SOA_BATCH
+		message += reqs.getRequestString(i);
+#else
 		message += cqrySet[i]->getRequestString();
+#endif
 	}
 
 	return message;
@@ -1787,6 +2255,12 @@ bool BatchRequests::validate(uint64_t thd_id)
 
 #endif
 
+#if BINARY_DIGEST
+	BatchDigest digest;
+	for (uint i = 0; i < get_batch_size(); i++)
+		digest.add(this->requestMsg[i]);
+	string batch_hash = digest.get_hash();
+#else
 	// String of transactions in a batch to generate hash.
 	string batchStr;
 	for (uint i = 0; i < get_batch_size(); i++)
@@ -1794,9 +2268,11 @@ bool BatchRequests::validate(uint64_t thd_id)
 		// Append string representation of this txn.
 		batchStr += this->requestMsg[i]->getString();
 	}
+	string batch_hash = calculateHash(batchStr);
+#endif
 
 	// Is hash of request message valid
-	if (this->hash != calculateHash(batchStr))
+	if (this->hash != batch_hash)
 	{
 		assert(0);
 		return false;
@@ -3146,6 +3622,12 @@ bool HOTSTUFFPrepareMsg::validate(uint64_t thd_id)
 
 #endif
 
+#if BINARY_DIGEST
+	BatchDigest digest;
+	for (uint i = 0; i < get_batch_size(); i++)
+		digest.add(this->requestMsg[i]);
+	string batch_hash = digest.get_hash();
+#else
 	// String of transactions in a batch to generate hash.
 	string batchStr;
 	for (uint i = 0; i < get_batch_size(); i++)
@@ -3153,9 +3635,11 @@ bool HOTSTUFFPrepareMsg::validate(uint64_t thd_id)
 		// Append string representation of this txn.
 		batchStr += this->requestMsg[i]->getString();
 	}
+	string batch_hash = calculateHash(batchStr);
+#endif
 
 	// Is hash of request message valid
-	if (this->hash != calculateHash(batchStr))
+	if (this->hash != batch_hash)
 	{
 		assert(0);
 		return false;
@@ -3965,13 +4449,17 @@ bool HOTSTUFFDecideMsg::validate()
 uint64_t HOTSTUFFNewViewMsg::get_size(){
 	uint64_t size = Message::mget_size();
 
-	size += sizeof(view);
+	size += WIRE_SIZE(view);
+#if COMPACT_WIRE
+	size += varint_size(zigzag(end_index - index));
+#else
 	size += sizeof(index);
+#endif
 	size += hash.length();
-	size += sizeof(hashSize);
-	size += sizeof(return_node);
-	size += sizeof(end_index);
-	size += sizeof(batch_size);
+	size += WIRE_SIZE(hashSize);
+	size += WIRE_SIZE(return_node);
+	size += WIRE_SIZE(end_index);
+	size += WIRE_SIZE(batch_size);
 	size += highQC.get_size();
 #if THRESHOLD_SIGNATURE
 	size += sizeof(psig_share);
@@ -4050,14 +4538,23 @@ void HOTSTUFFNewViewMsg::copy_from_buf(char *buf)
 	Message::mcopy_from_buf(buf);
 	uint64_t ptr = Message::mget_size();
 
-	COPY_VAL(view, buf, ptr);
+	COPY_WIRE_VAL(view, buf, ptr);
+#if COMPACT_WIRE
+	// index is sent as its distance back from end_index.
+	uint64_t index_delta;
+	COPY_VARINT(index_delta, buf, ptr);
+#else
 	COPY_VAL(index, buf, ptr);
-	COPY_VAL(hashSize, buf, ptr);
+#endif
+	COPY_WIRE_VAL(hashSize, buf, ptr);
 
 	ptr = buf_to_string(buf, ptr, hash, hashSize);
-	COPY_VAL(return_node, buf, ptr);
-	COPY_VAL(end_index, buf, ptr);
-	COPY_VAL(batch_size, buf, ptr);
+	COPY_WIRE_VAL(return_node, buf, ptr);
+	COPY_WIRE_VAL(end_index, buf, ptr);
+	COPY_WIRE_VAL(batch_size, buf, ptr);
+#if COMPACT_WIRE
+	index = end_index - unzigzag(index_delta);
+#endif
 
 	ptr = highQC.copy_from_buf(ptr, buf);
 #if THRESHOLD_SIGNATURE
@@ -4080,19 +4577,23 @@ void HOTSTUFFNewViewMsg::copy_to_buf(char *buf)
 
 	uint64_t ptr = Message::mget_size();
 
-	COPY_BUF(buf, view, ptr);
+	COPY_WIRE_BUF(buf, view, ptr);
+#if COMPACT_WIRE
+	COPY_BUF_VARINT(buf, zigzag(end_index - index), ptr);
+#else
 	COPY_BUF(buf, index, ptr);
-	COPY_BUF(buf, hashSize, ptr);
+#endif
+	COPY_WIRE_BUF(buf, hashSize, ptr);
 	char v;
 	for (uint64_t i = 0; i < hash.size(); i++)
 	{
 		v = hash[i];
 		COPY_BUF(buf, v, ptr);
 	}
-	COPY_BUF(buf, return_node, ptr);
+	COPY_WIRE_BUF(buf, return_node, ptr);
 
-	COPY_BUF(buf, end_index, ptr);
-	COPY_BUF(buf, batch_size, ptr);
+	COPY_WIRE_BUF(buf, end_index, ptr);
+	COPY_WIRE_BUF(buf, batch_size, ptr);
 	ptr = highQC.copy_to_buf(ptr, buf);
 #if THRESHOLD_SIGNATURE
 	COPY_BUF(buf, psig_share, ptr);
@@ -4113,7 +4614,14 @@ bool HOTSTUFFNewViewMsg::validate()
 {
 #if USE_CRYPTO
 
-#if MAC_SYNC
+#if VOTE_BUNDLE
+	// Authenticated together with the other votes of its frame.
+	if (!this->frame_auth)
+	{
+		assert(0);
+		return false;
+	}
+#elif MAC_SYNC
 		string message2 = this->toString();
 		if (!validateNodeNode(message2, this->pubKey, this->signature, this->return_node_id))
 		{
@@ -4145,21 +4653,40 @@ void HOTSTUFFNewViewMsg::release(){
 uint64_t HOTSTUFFProposalMsg::get_size()
 {
 	uint64_t size = Message::mget_size();
-	size += sizeof(view);
+	size += WIRE_SIZE(view);
+#if COMPACT_WIRE
+	// Indices are delta-encoded against the previous one.
+	uint64_t prev = 0;
+	for (uint i = 0; i < index.size(); i++)
+	{
+		size += varint_size(zigzag(index[i] - prev));
+		prev = index[i];
+	}
+#else
 	size += sizeof(uint64_t) * index.size();
-	size += sizeof(uint64_t);
+#endif
+	size += WIRE_SIZE(hashSize);
 	size += hash.length();
 
+#if SOA_BATCH
+	size += reqs.get_size();
+#else
 	for (uint i = 0; i < get_batch_size(); i++)
 	{
 		size += requestMsg[i]->get_size();
 	}
+#endif
 
-	size += sizeof(batch_size);
+	size += WIRE_SIZE(batch_size);
+#if TREE_DISSEMINATION
+	size += WIRE_SIZE(leaderSigSize);
+	size += leader_sig.length();
+#endif
 
 	return size;
 }
 
+#if !SOA_BATCH
 void HOTSTUFFProposalMsg::add_request_msg(uint idx, Message * msg){
      if(requestMsg[idx]){
  		Message::release_message(requestMsg[idx]);
@@ -4170,6 +4697,7 @@ void HOTSTUFFProposalMsg::add_request_msg(uint idx, Message * msg){
  	requestMsg[idx] = static_cast<YCSBClientQueryMessage*>(msg);
  #endif
  }
+#endif
 
 // Initialization
 void HOTSTUFFProposalMsg::init(uint64_t instance_id)
@@ -4183,7 +4711,11 @@ void HOTSTUFFProposalMsg::init(uint64_t instance_id)
 	this->instance_id = instance_id;
 	this->view = get_last_sent_view(instance_id);
 	this->index.init(get_batch_size());
+#if SOA_BATCH
+	this->reqs.init(get_batch_size());
+#else
 	this->requestMsg.resize(get_batch_size());
+#endif
 }
 
 void HOTSTUFFProposalMsg::copy_from_txn(TxnManager *txn)
@@ -4218,6 +4750,13 @@ void HOTSTUFFProposalMsg::copy_from_txn(TxnManager *txn, BankingSmartContractMes
 	add_request_msg(idx, yqry);
 	this->index.add(txnid);
 }
+#elif SOA_BATCH
+void HOTSTUFFProposalMsg::copy_from_txn(TxnManager *txn, RequestColumns &src, uint64_t i)
+{
+	// Queries are kept in the order of their transactions.
+	reqs.add(src, i);
+	this->index.add(txn->get_txn_id());
+}
 #else
 void HOTSTUFFProposalMsg::copy_from_txn(TxnManager *txn, YCSBClientQueryMessage *clqry)
 {
@@ -4243,7 +4782,11 @@ string HOTSTUFFProposalMsg::getString(uint64_t sender){
 	for (uint i = 0; i < get_batch_size(); i++)
 	{
 		message += std::to_string(index[i]);
+#if SOA_BATCH
+		message += reqs.getRequestString(i);
+#else
 		message += requestMsg[i]->getRequestString();
+#endif
 	}
 	message += hash;
 
@@ -4273,28 +4816,49 @@ void HOTSTUFFProposalMsg::copy_from_buf(char *buf)
 	Message::mcopy_from_buf(buf);
 
 	uint64_t ptr = Message::mget_size();
-	COPY_VAL(view, buf, ptr);
+	COPY_WIRE_VAL(view, buf, ptr);
 
 	uint64_t elem;
+#if COMPACT_WIRE
+	uint64_t prev = 0;
+#endif
 	release();
 	// Initialization
 	index.init(get_batch_size());
+#if !SOA_BATCH
 	requestMsg.resize(get_batch_size());
+#endif
 
 	for (uint i = 0; i < get_batch_size(); i++)
 	{
+#if COMPACT_WIRE
+		COPY_VARINT(elem, buf, ptr);
+		elem = prev + unzigzag(elem);
+		prev = elem;
+#else
 		COPY_VAL(elem, buf, ptr);
+#endif
 		index.add(elem);
 
+#if !SOA_BATCH
 		Message *msg = create_message(&buf[ptr]);
 		ptr += msg->get_size();
 		add_request_msg(i, msg);
+#endif
 	}
+#if SOA_BATCH
+	ptr = reqs.copy_from_buf(buf, ptr);
+	assert(reqs.size() == get_batch_size());
+#endif
 
-	COPY_VAL(hashSize, buf, ptr);
+	COPY_WIRE_VAL(hashSize, buf, ptr);
 	ptr = buf_to_string(buf, ptr, hash, hashSize);
 
-	COPY_VAL(batch_size, buf, ptr);
+	COPY_WIRE_VAL(batch_size, buf, ptr);
+#if TREE_DISSEMINATION
+	COPY_WIRE_VAL(leaderSigSize, buf, ptr);
+	ptr = buf_to_string(buf, ptr, leader_sig, leaderSigSize);
+#endif
 
 	assert(ptr == get_size());
 }
@@ -4305,20 +4869,33 @@ void HOTSTUFFProposalMsg::copy_to_buf(char *buf)
 	Message::mcopy_to_buf(buf);
 
 	uint64_t ptr = Message::mget_size();
-	COPY_BUF(buf, view, ptr);
+	COPY_WIRE_BUF(buf, view, ptr);
 
 	uint64_t elem;
+#if COMPACT_WIRE
+	uint64_t prev = 0;
+#endif
 	for (uint i = 0; i < get_batch_size(); i++)
 	{
 		elem = index[i];
+#if COMPACT_WIRE
+		COPY_BUF_VARINT(buf, zigzag(elem - prev), ptr);
+		prev = elem;
+#else
 		COPY_BUF(buf, elem, ptr);
+#endif
 
+#if !SOA_BATCH
 		//copy client request stored in message to buf
 		requestMsg[i]->copy_to_buf(&buf[ptr]);
 		ptr += requestMsg[i]->get_size();
+#endif
 	}
+#if SOA_BATCH
+	ptr = reqs.copy_to_buf(buf, ptr);
+#endif
 
-	COPY_BUF(buf, hashSize, ptr);
+	COPY_WIRE_BUF(buf, hashSize, ptr);
 
 	char v;
 	for (uint j = 0; j < hash.size(); j++)
@@ -4327,7 +4904,11 @@ void HOTSTUFFProposalMsg::copy_to_buf(char *buf)
 		COPY_BUF(buf, v, ptr);
 	}
 
-	COPY_BUF(buf, batch_size, ptr);
+	COPY_WIRE_BUF(buf, batch_size, ptr);
+#if TREE_DISSEMINATION
+	COPY_WIRE_BUF(buf, leaderSigSize, ptr);
+	ptr = string_to_buf(buf, ptr, leader_sig);
+#endif
 
 	assert(ptr == get_size());
 }
@@ -4336,31 +4917,38 @@ void HOTSTUFFProposalMsg::copy_to_buf(char *buf)
 //makes sure message is valid, returns true for false
 bool HOTSTUFFProposalMsg::validate(uint64_t thd_id)
 {
-
-#if USE_CRYPTO
-
-#if MAC_SYNC
-	string message = getString(this->return_node_id);
-	if (!validateNodeNode(message, this->pubKey, this->signature, this->return_node_id))
+#if TREE_DISSEMINATION
+	// The MAC only vouches for the tree parent that forwarded the proposal;
+	// the leader's signature vouches for its digest.
+	uint64_t leader = get_view_primary(this->view, this->instance_id);
+	if (this->return_node_id != tree_parent(leader, g_node_id) || !validate_leader(leader))
 	{
 		assert(0);
 		return false;
 	}
 #endif
 
+#if USE_CRYPTO
 
+#if MAC_SYNC
+#if EC_DISSEMINATION
+	if (!this->ec_rebuilt)
 #endif
-
-	// String of transactions in a batch to generate hash.
-	string batchStr;
-	for (uint i = 0; i < get_batch_size(); i++)
 	{
-		// Append string representation of this txn.
-		batchStr += this->requestMsg[i]->getString();
+		string message = getString(this->return_node_id);
+		if (!validateNodeNode(message, this->pubKey, this->signature, this->return_node_id))
+		{
+			assert(0);
+			return false;
+		}
 	}
+#endif
+
+
+#endif
 
 	// Is hash of request message valid
-	if (this->hash != calculateHash(batchStr))
+	if (this->hash != get_batch_hash())
 	{
 		assert(0);
 		return false;
@@ -4369,27 +4957,100 @@ bool HOTSTUFFProposalMsg::validate(uint64_t thd_id)
 	return true;
 }
 
+// Digest of the batch, as computed by the primary.
+string HOTSTUFFProposalMsg::get_batch_hash()
+{
+#if BINARY_DIGEST
+	BatchDigest digest;
+	for (uint i = 0; i < get_batch_size(); i++)
+	{
+#if SOA_BATCH
+		digest.add(reqs, i);
+#else
+		digest.add(this->requestMsg[i]);
+#endif
+	}
+	return digest.get_hash();
+#else
+	// String of transactions in a batch to generate hash.
+	string batchStr;
+	for (uint i = 0; i < get_batch_size(); i++)
+	{
+		// Append string representation of this txn.
+#if SOA_BATCH
+		batchStr += reqs.getString(i);
+#else
+		batchStr += this->requestMsg[i]->getString();
+#endif
+	}
+	return calculateHash(batchStr);
+#endif
+}
+
 void HOTSTUFFProposalMsg::release()
 {
 	index.release();
+#if SOA_BATCH
+	reqs.release();
+#else
 	for (uint64_t i = 0; i < requestMsg.size(); i++)
 	{
 		Message::release_message(requestMsg[i]);
 	}
 	requestMsg.clear();
+#endif
 	hash.clear();
+#if TREE_DISSEMINATION
+	leader_sig.clear();
+#endif
+}
+
+#if TREE_DISSEMINATION
+string HOTSTUFFProposalMsg::getLeaderString()
+{
+	string message = std::to_string(view);
+	message += '_' + std::to_string(instance_id);
+	message += '_' + std::to_string(txn_id);
+	message += '_' + hash;
+	return message;
+}
+
+// Signed like a chunk, as replicas below the leader's children get the
+// proposal from another replica.
+void HOTSTUFFProposalMsg::sign_leader()
+{
+#if USE_CRYPTO && CRYPTO_METHOD_ED25519
+	leader_sig = ED25519signString(getLeaderString());
+#else
+	leader_sig = "0";
+#endif
+	leaderSigSize = leader_sig.size();
+}
+
+bool HOTSTUFFProposalMsg::validate_leader(uint64_t leader)
+{
+#if USE_CRYPTO && CRYPTO_METHOD_ED25519
+	return ED25519checkString(getLeaderString(), leader_sig, leader);
+#else
+	return true;
+#endif
 }
+#endif
 
 uint64_t HOTSTUFFGenericMsg::get_size()
 {
 	uint64_t size = Message::mget_size();
-	size += sizeof(view);
+	size += WIRE_SIZE(view);
+#if COMPACT_WIRE
+	size += varint_size(zigzag(end_index - index));
+#else
 	size += sizeof(index);
+#endif
 	size += hash.length();
-	size += sizeof(hashSize);
-	size += sizeof(return_node);
-	size += sizeof(end_index);
-	size += sizeof(batch_size);
+	size += WIRE_SIZE(hashSize);
+	size += WIRE_SIZE(return_node);
+	size += WIRE_SIZE(end_index);
+	size += WIRE_SIZE(batch_size);
 
 #if THRESHOLD_SIGNATURE
 	size += sizeof(psig_share);
@@ -4459,15 +5120,24 @@ void HOTSTUFFGenericMsg::copy_from_buf(char *buf)
 
 	uint64_t ptr = Message::mget_size();
 
-	COPY_VAL(view, buf, ptr);
+	COPY_WIRE_VAL(view, buf, ptr);
+#if COMPACT_WIRE
+	// index is sent as its distance back from end_index.
+	uint64_t index_delta;
+	COPY_VARINT(index_delta, buf, ptr);
+#else
 	COPY_VAL(index, buf, ptr);
-	COPY_VAL(hashSize, buf, ptr);
+#endif
+	COPY_WIRE_VAL(hashSize, buf, ptr);
 
 	ptr = buf_to_string(buf, ptr, hash, hashSize);
 
-	COPY_VAL(return_node, buf, ptr);
-	COPY_VAL(end_index, buf, ptr);
-	COPY_VAL(batch_size, buf, ptr);
+	COPY_WIRE_VAL(return_node, buf, ptr);
+	COPY_WIRE_VAL(end_index, buf, ptr);
+	COPY_WIRE_VAL(batch_size, buf, ptr);
+#if COMPACT_WIRE
+	index = end_index - unzigzag(index_delta);
+#endif
 
 	ptr = highQC.copy_from_buf(ptr, buf);
 
@@ -4484,9 +5154,13 @@ void HOTSTUFFGenericMsg::copy_to_buf(char *buf)
 
 	uint64_t ptr = Message::mget_size();
 
-	COPY_BUF(buf, view, ptr);
+	COPY_WIRE_BUF(buf, view, ptr);
+#if COMPACT_WIRE
+	COPY_BUF_VARINT(buf, zigzag(end_index - index), ptr);
+#else
 	COPY_BUF(buf, index, ptr);
-	COPY_BUF(buf, hashSize, ptr);
+#endif
+	COPY_WIRE_BUF(buf, hashSize, ptr);
 
 	char v;
 	for (uint64_t i = 0; i < hash.size(); i++)
@@ -4495,10 +5169,10 @@ void HOTSTUFFGenericMsg::copy_to_buf(char *buf)
 		COPY_BUF(buf, v, ptr);
 	}
 
-	COPY_BUF(buf, return_node, ptr);
+	COPY_WIRE_BUF(buf, return_node, ptr);
 
-	COPY_BUF(buf, end_index, ptr);
-	COPY_BUF(buf, batch_size, ptr);
+	COPY_WIRE_BUF(buf, end_index, ptr);
+	COPY_WIRE_BUF(buf, batch_size, ptr);
 
 	ptr = highQC.copy_to_buf(ptr, buf);
 	
@@ -4550,6 +5224,148 @@ void HOTSTUFFGenericMsg::release(){
 
 
 #endif
+#if EC_DISSEMINATION
+uint64_t HOTSTUFFChunkMsg::get_size()
+{
+	uint64_t size = Message::mget_size();
+	size += sizeof(view);
+	size += sizeof(chunk_idx);
+	size += sizeof(data_size);
+	size += sizeof(hashSize);
+	size += hash.length();
+	size += sizeof(dataHashSize);
+	size += data_hash.length();
+	size += sizeof(leaderSigSize);
+	size += leader_sig.length();
+	size += sizeof(chunkSize);
+	size += chunk.length();
+	return size;
+}
+
+void HOTSTUFFChunkMsg::copy_from_buf(char *buf)
+{
+	Message::mcopy_from_buf(buf);
+
+	uint64_t ptr = Message::mget_size();
+	COPY_VAL(view, buf, ptr);
+	COPY_VAL(chunk_idx, buf, ptr);
+	COPY_VAL(data_size, buf, ptr);
+	COPY_VAL(hashSize, buf, ptr);
+	ptr = buf_to_string(buf, ptr, hash, hashSize);
+	COPY_VAL(dataHashSize, buf, ptr);
+	ptr = buf_to_string(buf, ptr, data_hash, dataHashSize);
+	COPY_VAL(leaderSigSize, buf, ptr);
+	ptr = buf_to_string(buf, ptr, leader_sig, leaderSigSize);
+	COPY_VAL(chunkSize, buf, ptr);
+	chunk.assign(&buf[ptr], chunkSize);
+	ptr += chunkSize;
+
+	assert(ptr == get_size());
+}
+
+void HOTSTUFFChunkMsg::copy_to_buf(char *buf)
+{
+	Message::mcopy_to_buf(buf);
+
+	uint64_t ptr = Message::mget_size();
+	COPY_BUF(buf, view, ptr);
+	COPY_BUF(buf, chunk_idx, ptr);
+	COPY_BUF(buf, data_size, ptr);
+	COPY_BUF(buf, hashSize, ptr);
+	ptr = string_to_buf(buf, ptr, hash);
+	COPY_BUF(buf, dataHashSize, ptr);
+	ptr = string_to_buf(buf, ptr, data_hash);
+	COPY_BUF(buf, leaderSigSize, ptr);
+	ptr = string_to_buf(buf, ptr, leader_sig);
+	COPY_BUF(buf, chunkSize, ptr);
+	memcpy(&buf[ptr], chunk.data(), chunkSize);
+	ptr += chunkSize;
+
+	assert(ptr == get_size());
+}
+
+void HOTSTUFFChunkMsg::release()
+{
+	hash.clear();
+	data_hash.clear();
+	leader_sig.clear();
+	chunk.clear();
+}
+
+string HOTSTUFFChunkMsg::getString(uint64_t sender)
+{
+	string message = std::to_string(sender);
+	message += std::to_string(view);
+	message += std::to_string(chunk_idx);
+	message += std::to_string(data_size);
+	message += hash;
+	message += data_hash;
+	message += leader_sig;
+	message += chunk;
+	return message;
+}
+
+string HOTSTUFFChunkMsg::getLeaderString()
+{
+	string message = std::to_string(view);
+	message += '_' + std::to_string(instance_id);
+	message += '_' + std::to_string(txn_id);
+	message += '_' + std::to_string(data_size);
+	message += '_' + data_hash;
+	return message;
+}
+
+/*
+	Chunks reach most replicas through other replicas, whose MACs say nothing
+	about the leader. The leader's signature travels with every chunk instead,
+	so it needs a key every replica can check.
+*/
+void HOTSTUFFChunkMsg::sign_leader()
+{
+#if USE_CRYPTO && CRYPTO_METHOD_ED25519
+	leader_sig = ED25519signString(getLeaderString());
+#else
+	leader_sig = "0";
+#endif
+	leaderSigSize = leader_sig.size();
+}
+
+bool HOTSTUFFChunkMsg::validate_leader(uint64_t leader)
+{
+#if USE_CRYPTO && CRYPTO_METHOD_ED25519
+	return ED25519checkString(getLeaderString(), leader_sig, leader);
+#else
+	return true;
+#endif
+}
+
+void HOTSTUFFChunkMsg::sign(uint64_t dest_node)
+{
+#if USE_CRYPTO
+	#if MAC_SYNC
+		string message = getString(g_node_id);	// MAC
+		signingNodeNode(message, this->signature, this->pubKey, dest_node);
+	#endif
+#else
+	this->signature = "0";
+#endif
+	this->sigSize = this->signature.size();
+	this->keySize = this->pubKey.size();
+}
+
+bool HOTSTUFFChunkMsg::validate()
+{
+#if USE_CRYPTO && MAC_SYNC
+	string message = getString(this->return_node_id);
+	if (!validateNodeNode(message, this->pubKey, this->signature, this->return_node_id))
+	{
+		return false;
+	}
+#endif
+	return true;
+}
+#endif
+
 vector<vector<Message *>> new_view_msgs;
 
 #endif	//CONSENSUS == HOTSTUFF
@@ -5,14 +5,34 @@
 #include "array.h"
 #include <mutex>
 
+#if COMPACT_WIRE
+#define WIRE_STATS 0x1 // Header carries the latency stats
+#endif
+
 class ycsb_request;
 class LogRecord;
 struct Item_no;
 
+// Latency stats, only filled in for messages built from a transaction.
+struct MsgStats
+{
+    uint64_t ntwk_time = 0;
+    double lat_work_queue_time = 0;
+    double lat_msg_queue_time = 0;
+    double lat_cc_block_time = 0;
+    double lat_cc_time = 0;
+    double lat_process_time = 0;
+    double lat_network_time = 0;
+    double lat_other_time = 0;
+};
+
 class Message
 {
 public:
-    virtual ~Message() { this->dest.clear(); }
+    virtual ~Message()
+    {
+        this->dest.clear();
+    }
     static Message *create_message(char *buf);
     static Message *create_message(BaseQuery *query, RemReqType rtype);
     static Message *create_message(TxnManager *txn, RemReqType rtype);
@@ -20,16 +40,29 @@ public:
     static Message *create_message(uint64_t txn_id, uint64_t batch_id, RemReqType rtype);
     static Message *create_message(LogRecord *record, RemReqType rtype);
     static Message *create_message(RemReqType rtype);
-    static std::vector<Message *> *create_messages(char *buf);
+    static std::vector<Message *> *create_messages(char *buf, uint64_t size);
     static void release_message(Message *msg, uint64_t pos = 0);
+
+    // Fixed header, touched for every message.
     RemReqType rtype;
+#if PVP
+    bool force = false;
+#endif
+#if VOTE_BUNDLE
+    // Set on receipt when the carrying frame was sealed with a valid MAC.
+    bool frame_auth = false;
+#endif
+#if SHARPER
+    bool is_cross_shard = false;
+#endif
+#if PVP
+    uint64_t instance_id;
+#endif
     uint64_t txn_id;
     uint64_t batch_id;
     uint64_t return_node_id;
-
     uint64_t wq_time;
     uint64_t mq_time;
-    uint64_t ntwk_time;
 
     //signature is 768 chars, pubkey is 840
     uint64_t sigSize = 1;
@@ -37,37 +70,32 @@ public:
     string signature = "0";
     string pubKey = "0";
 
-#if THRESHOLD_SIGNATURE
-    secp256k1_ecdsa_signature psig_share;
-    bool sig_empty = true;
-    secp256k1_ecdsa_signature sig_share;
-#endif
+    vector<uint64_t> dest;
 
-#if PVP
-    uint64_t instance_id;
-    bool force = false;
+    // Collect other stats; has_lat is set once the message carries them.
+#if STATS_ENABLE
+    bool has_lat = false;
+    MsgStats lat;
+    MsgStats *get_lat()
+    {
+        has_lat = true;
+        return &lat;
+    }
+#else
+    static const bool has_lat = false;
 #endif
 
     static uint64_t string_to_buf(char *buf, uint64_t ptr, string str);
     static uint64_t buf_to_string(char *buf, uint64_t ptr, string &str, uint64_t strSize);
 
-    vector<uint64_t> dest;
-
-    // Collect other stats
-    double lat_work_queue_time;
-    double lat_msg_queue_time;
-    double lat_cc_block_time;
-    double lat_cc_time;
-    double lat_process_time;
-    double lat_network_time;
-    double lat_other_time;
-
     uint64_t mget_size();
     uint64_t get_txn_id() { return txn_id; }
     uint64_t get_batch_id() { return batch_id; }
     uint64_t get_return_id() { return return_node_id; }
     void mcopy_from_buf(char *buf);
     void mcopy_to_buf(char *buf);
+    uint64_t lat_from_buf(char *buf, uint64_t ptr);
+    uint64_t lat_to_buf(char *buf, uint64_t ptr);
     void mcopy_from_txn(TxnManager *txn);
     void mcopy_to_txn(TxnManager *txn);
     RemReqType get_rtype() { return rtype; }
@@ -79,9 +107,6 @@ public:
     virtual void copy_from_txn(TxnManager *txn) = 0;
     virtual void init() = 0;
     virtual void release() = 0;
-#if SHARPER
-    bool is_cross_shard = false;
-#endif
 };
 
 // Message types
@@ -247,6 +272,86 @@ public:
     bool validate();
 };
 
+#if SOA_BATCH
+// Client queries of a batch stored column by column. Query i holds the
+// reqs_per_query keys and values from i * reqs_per_query on. Each column goes
+// on the wire in one piece.
+class RequestColumns
+{
+public:
+    void init(uint64_t query_cnt);
+    void release();
+    void add(YCSBClientQueryMessage *clqry);
+    void add(RequestColumns &src, uint64_t i);
+    // Query i rebuilt as a message, for paths that still take one.
+    YCSBClientQueryMessage *get_query(uint64_t i);
+    uint64_t size() { return client_ts.size(); }
+
+    uint64_t get_size();
+    uint64_t copy_from_buf(char *buf, uint64_t ptr);
+    uint64_t copy_to_buf(char *buf, uint64_t ptr);
+    // Same strings as YCSBClientQueryMessage builds for query i.
+    string getRequestString(uint64_t i);
+    string getString(uint64_t i);
+
+    uint64_t reqs_per_query = 0;
+    vector<uint64_t> keys;
+    vector<uint64_t> values;
+    vector<uint64_t> client_ts;
+    vector<uint64_t> return_node;
+};
+#endif
+
+#if BINARY_DIGEST
+// SHA-256 of a batch, fed per query with its keys, values, client timestamp
+// and client in binary. With MERKLE_DIGEST each query is a leaf and the
+// digest is the root of the tree over them.
+class BatchDigest
+{
+public:
+    void add(YCSBClientQueryMessage *clqry);
+#if SOA_BATCH
+    void add(RequestColumns &reqs, uint64_t i);
+#endif
+    string get_hash();
+#if MERKLE_DIGEST
+    // Sibling hashes on the path from leaf i to the root, after get_hash().
+    vector<string> get_proof(uint64_t i);
+    static string hash_leaf(const uint64_t *vals, uint64_t cnt);
+    static bool verify_proof(const string &leaf, uint64_t i, uint64_t leaf_cnt,
+                             const vector<string> &proof, const string &root);
+#endif
+
+private:
+    void add(uint64_t val) { add(&val, 1); }
+#if MERKLE_DIGEST
+    void add(const uint64_t *vals, uint64_t cnt) { words.insert(words.end(), vals, vals + cnt); }
+    void start_leaf() { leaf_start.push_back(words.size()); }
+    void hash_leaves(uint64_t from, uint64_t to);
+    vector<uint64_t> words;      // all queries back to back
+    vector<uint64_t> leaf_start; // where each query starts in words
+    vector<vector<string>> levels; // leaves first, root last
+
+    // Leaves from..to of a digest, queued for the helper threads.
+    struct LeafSlice
+    {
+        BatchDigest *digest;
+        uint64_t from;
+        uint64_t to;
+        std::atomic<uint64_t> *left; // slices of the digest not hashed yet
+    };
+    struct SlicePool;
+    static SlicePool *pool;
+    static void start_pool();
+    static bool run_slice(bool wait);
+#else
+    void add(const uint64_t *vals, uint64_t cnt) { sha.Update((const byte *)vals, sizeof(uint64_t) * cnt); }
+    void start_leaf() {}
+    CryptoPP::SHA256 sha;
+#endif
+};
+#endif
+
 #if CLIENT_BATCH
 class ClientQueryBatch : public Message
 {
@@ -272,6 +377,8 @@ public:
     uint64_t batch_size;
 #if BANKING_SMART_CONTRACT
     Array<BankingSmartContractMessage *> cqrySet;
+#elif SOA_BATCH
+    RequestColumns reqs;
 #else
     Array<YCSBClientQueryMessage *> cqrySet;
 #endif
@@ -619,7 +726,17 @@ void clearAllVCMsg();
 
 #if CONSENSUS == HOTSTUFF
 
-class HOTSTUFFPrepareMsg : public Message{
+// Phase messages of HotStuff, the only ones that carry signature shares.
+class HOTSTUFFShareMsg : public Message{
+public:
+#if THRESHOLD_SIGNATURE
+    secp256k1_ecdsa_signature psig_share;
+    bool sig_empty = true;
+    secp256k1_ecdsa_signature sig_share;
+#endif
+};
+
+class HOTSTUFFPrepareMsg : public HOTSTUFFShareMsg{
 public:
     void copy_from_buf(char *buf);
     void copy_to_buf(char *buf);
@@ -655,7 +772,7 @@ public:
     QuorumCertificate highQC;
 };
 
-class HOTSTUFFPrepareVoteMsg : public Message{
+class HOTSTUFFPrepareVoteMsg : public HOTSTUFFShareMsg{
     public:
     void copy_from_buf(char *buf);
     void copy_to_buf(char *buf);
@@ -678,7 +795,7 @@ class HOTSTUFFPrepareVoteMsg : public Message{
     uint32_t batch_size;
 };
 
-class HOTSTUFFPreCommitMsg : public Message{
+class HOTSTUFFPreCommitMsg : public HOTSTUFFShareMsg{
 public:
     void copy_from_buf(char *buf);
     void copy_to_buf(char *buf);
@@ -703,7 +820,7 @@ public:
     QuorumCertificate PreparedQC;
 };
 
-class HOTSTUFFPreCommitVoteMsg : public Message{
+class HOTSTUFFPreCommitVoteMsg : public HOTSTUFFShareMsg{
 public:
     void copy_from_buf(char *buf);
     void copy_to_buf(char *buf);
@@ -726,7 +843,7 @@ public:
     uint32_t batch_size;
 };
 
-class HOTSTUFFCommitMsg : public Message{
+class HOTSTUFFCommitMsg : public HOTSTUFFShareMsg{
 public:
     void copy_from_buf(char *buf);
     void copy_to_buf(char *buf);
@@ -751,7 +868,7 @@ public:
     QuorumCertificate PreCommittedQC;
 };
 
-class HOTSTUFFCommitVoteMsg : public Message{
+class HOTSTUFFCommitVoteMsg : public HOTSTUFFShareMsg{
 public:
     void copy_from_buf(char *buf);
     void copy_to_buf(char *buf);
@@ -774,7 +891,7 @@ public:
     uint32_t batch_size;
 };
 
-class HOTSTUFFDecideMsg : public Message{
+class HOTSTUFFDecideMsg : public HOTSTUFFShareMsg{
     public:
     void copy_from_buf(char *buf);
     void copy_to_buf(char *buf);
@@ -799,7 +916,7 @@ class HOTSTUFFDecideMsg : public Message{
     QuorumCertificate CommittedQC;
 };
 
-class HOTSTUFFNewViewMsg : public Message{
+class HOTSTUFFNewViewMsg : public HOTSTUFFShareMsg{
     public:
     void copy_from_buf(char *buf);
     void copy_to_buf(char *buf);
@@ -835,6 +952,8 @@ public:
     void copy_from_txn(TxnManager *txn);
 #if BANKING_SMART_CONTRACT
     void copy_from_txn(TxnManager *txn, BankingSmartContractMessage *clqry);
+#elif SOA_BATCH
+    void copy_from_txn(TxnManager *txn, RequestColumns &src, uint64_t i);
 #else
     void copy_from_txn(TxnManager *txn, YCSBClientQueryMessage *clqry);
 #endif
@@ -848,23 +967,41 @@ public:
 
     bool validate(uint64_t thd_id);
     string getString(uint64_t sender);
+    string get_batch_hash();
 
+#if !SOA_BATCH
     void add_request_msg(uint idx, Message *msg);
+#endif
 
     uint64_t view;
 
     Array<uint64_t> index;
 #if BANKING_SMART_CONTRACT
     vector<BankingSmartContractMessage *> requestMsg;
+#elif SOA_BATCH
+    RequestColumns reqs;
 #else
     vector<YCSBClientQueryMessage *> requestMsg;
 #endif
     uint64_t hashSize; // Representative hash for the batch.
     string hash;
     uint32_t batch_size;
+#if EC_DISSEMINATION
+    // Rebuilt from chunks, which were authenticated hop by hop.
+    bool ec_rebuilt = false;
+#endif
+#if TREE_DISSEMINATION
+    // What the leader signs: the proposal's slot and batch digest.
+    string getLeaderString();
+    void sign_leader();
+    bool validate_leader(uint64_t leader);
+
+    uint64_t leaderSigSize;
+    string leader_sig; // Leader's signature of getLeaderString()
+#endif
 };
 
-class HOTSTUFFGenericMsg : public Message{
+class HOTSTUFFGenericMsg : public HOTSTUFFShareMsg{
     public:
     void copy_from_buf(char *buf);
     void copy_to_buf(char *buf);
@@ -900,6 +1037,40 @@ class HOTSTUFFGenericMsg : public HOTSTUFFPrepareMsg{
 };
 #endif
 
+#if EC_DISSEMINATION
+// One erasure-coded chunk of a serialized HOTSTUFFProposalMsg.
+class HOTSTUFFChunkMsg : public Message{
+public:
+    void copy_from_buf(char *buf);
+    void copy_to_buf(char *buf);
+    void copy_from_txn(TxnManager *txn){}
+    void copy_to_txn(TxnManager *txn){}
+    uint64_t get_size();
+    void init() {}
+    void release();
+
+    void sign(uint64_t dest_node = UINT64_MAX);
+    bool validate();
+    string getString(uint64_t sender);
+    // What the leader signs: the proposal's slot, size and digest.
+    string getLeaderString();
+    void sign_leader();
+    bool validate_leader(uint64_t leader);
+
+    uint64_t view;
+    uint64_t chunk_idx;  // Replica the chunk belongs to
+    uint64_t data_size;  // Size of the serialized proposal
+    uint64_t hashSize;
+    string hash;         // Digest of the batch
+    uint64_t dataHashSize;
+    string data_hash;    // Digest of the serialized proposal
+    uint64_t leaderSigSize;
+    string leader_sig;   // Leader's signature of getLeaderString()
+    uint64_t chunkSize;
+    string chunk;
+};
+#endif
+
 extern vector<vector<Message *>> new_view_msgs;
 
 #endif  //CONSENSUS == HOTSTUFF
@@ -269,12 +269,20 @@ bool CommitCertificateMessage::validate()
     }
 
 #endif
+#if BINARY_DIGEST
+    BatchDigest digest;
+    for (uint64_t i = 0; i < get_batch_size(); i++)
+        digest.add(this->requestMsg[i]);
+    string batch_hash = digest.get_hash();
+#else
     string batchStr = "";
     for (uint64_t i = 0; i < get_batch_size(); i++)
     {
         batchStr += this->requestMsg[i]->getString();
     }
-    if (this->hash != calculateHash(batchStr))
+    string batch_hash = calculateHash(batchStr);
+#endif
+    if (this->hash != batch_hash)
     {
         assert(0);
         return false;
@@ -21,6 +21,10 @@ void MessageThread::init(uint64_t thd_id)
         buffer[n]->init(n);
         buffer[n]->reset(n);
     }
+#if SG_SEND
+    sg_buf = (char *)mem_allocator.align_alloc(g_msg_size);
+    sg_head = (char *)mem_allocator.align_alloc(SG_HEAD_MAX);
+#endif
     _thd_id = thd_id;
 }
 
@@ -35,23 +39,104 @@ void MessageThread::check_and_send_batches()
     }
 }
 
+// Time after which held mbufs have to be checked again, 0 if none is held.
+uint64_t MessageThread::flush_timeout()
+{
+    uint64_t timeout = 0;
+#if VOTE_BUNDLE
+    if (bundle_pending > 0)
+        timeout = VOTE_BUNDLE_WAIT;
+#endif
+#if ADAPTIVE_FLUSH
+    if (held_cnt > 0 && (timeout == 0 || MBUF_MIN_HOLD < timeout))
+        timeout = MBUF_MIN_HOLD;
+#endif
+#if SEND_BACKPRESSURE || QUORUM_START
+    if (tport_man.has_parked(_thd_id) && (timeout == 0 || PEER_RETRY_WAIT < timeout))
+        timeout = PEER_RETRY_WAIT;
+#endif
+#if IO_URING_TRANSPORT
+    if (tport_man.has_inflight(_thd_id) && (timeout == 0 || URING_WAIT < timeout))
+        timeout = URING_WAIT;
+#endif
+    return timeout;
+}
+
 void MessageThread::send_batch(uint64_t dest_node_id)
 {
     mbuf *sbuf = buffer[dest_node_id];
     assert(sbuf->cnt > 0);
+    uint64_t now = get_sys_clock();
+    INC_STATS(_thd_id, msg_batch_cnt, 1);
+    INC_STATS(_thd_id, msg_batch_size_msgs, sbuf->cnt);
+    INC_STATS(_thd_id, msg_batch_size_bytes, sbuf->ptr);
+    if (ISSERVERN(dest_node_id))
+    {
+        INC_STATS(_thd_id, msg_batch_size_bytes_to_server, sbuf->ptr);
+    }
+    else
+    {
+        INC_STATS(_thd_id, msg_batch_size_bytes_to_client, sbuf->ptr);
+    }
+    INC_STATS(_thd_id, mbuf_send_intv_time, now - sbuf->starttime);
+#if ADAPTIVE_FLUSH
+    INC_STATS(_thd_id, mbuf_wait_time, sbuf->cnt * now - sbuf->enq_sum);
+    held_cnt--;
+#endif
     ((uint32_t *)sbuf->buffer)[2] = sbuf->cnt;
+#if VOTE_BUNDLE
+    if (sbuf->bundled)
+    {
+        // Seal the whole frame with one MAC: [frame][mac][mac size].
+        ((uint32_t *)sbuf->buffer)[2] |= VOTE_BUNDLE_FLAG;
+        string frame(sbuf->buffer, sbuf->ptr);
+        string mac = CmacSignString(cmacPrivateKeys[dest_node_id], frame);
+        uint32_t mac_size = mac.size();
+        assert(mac_size + sizeof(mac_size) <= VOTE_BUNDLE_TRAILER);
+        memcpy(&sbuf->buffer[sbuf->ptr], mac.c_str(), mac_size);
+        sbuf->ptr += mac_size;
+        COPY_BUF(sbuf->buffer, mac_size, sbuf->ptr);
+        bundle_pending--;
+    }
+#endif
     //printf("Send batch of %ld msgs to %ld\n", sbuf->cnt, dest_node_id);
     DEBUG("Send batch of %ld msgs to %ld\n", sbuf->cnt, dest_node_id);
     tport_man.send_msg(_thd_id, dest_node_id, sbuf->buffer, sbuf->ptr);
     sbuf->reset(dest_node_id);
 }
 
+#if SG_SEND
+// Sends one message in its own frame as [frame header][message header][payload],
+// where the payload is shared by all destinations of the message.
+void MessageThread::send_gathered(Message *msg, uint64_t dest_node_id, char *body, uint64_t body_len)
+{
+    // Keep the order of messages to this destination.
+    if (buffer[dest_node_id]->cnt > 0)
+        send_batch(dest_node_id);
+
+    uint32_t frame[3];
+    frame[0] = dest_node_id;
+    frame[1] = g_node_id;
+    frame[2] = 1;
+    uint64_t head_size = msg->mget_size();
+    assert(head_size <= SG_HEAD_MAX);
+    msg->mcopy_to_buf(sg_head);
+
+    nng_iov iov[3];
+    iov[0].iov_buf = frame;
+    iov[0].iov_len = sizeof(frame);
+    iov[1].iov_buf = sg_head;
+    iov[1].iov_len = head_size;
+    iov[2].iov_buf = body;
+    iov[2].iov_len = body_len;
+    tport_man.send_msg_iov(_thd_id, dest_node_id, iov, 3);
+}
+#endif
+
 void MessageThread::run()
 {
     Message *msg = NULL;
     uint64_t dest_node_id;
-    vector<uint64_t> dest;
-    vector<string> allsign;
     mbuf *sbuf;
 
     // Relative Id of the server's output thread.
@@ -65,12 +150,38 @@ void MessageThread::run()
     UInt32 td_id = _thd_id % g_this_send_thread_cnt;
 #endif
 
+#if SEND_BACKPRESSURE || QUORUM_START
+    tport_man.retry_parked(_thd_id);
+#endif
+#if IO_URING_TRANSPORT
+    // Submits what the previous call queued and picks up completed sends.
+    tport_man.flush_sends(_thd_id);
+#endif
+
 #if SEMA_TEST
     if(ISSERVER){
         if (simulation->is_warmup_done()){
             idle_starttime = get_sys_clock();
         }
         // Wait until there is a msg in the queue (the value of the semaphore is not zero), then decrease the value by 1
+#if VOTE_BUNDLE || ADAPTIVE_FLUSH || SEND_BACKPRESSURE || IO_URING_TRANSPORT || QUORUM_START
+        uint64_t timeout = flush_timeout();
+        if (timeout > 0)
+        {
+            // Held mbufs must not outlive their window while the queue is empty.
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += timeout;
+            deadline.tv_sec += deadline.tv_nsec / BILLION;
+            deadline.tv_nsec %= BILLION;
+            if (sem_timedwait(&output_semaphore[td_id], &deadline) != 0)
+            {
+                check_and_send_batches();
+                return;
+            }
+        }
+        else
+#endif
         sem_wait(&output_semaphore[td_id]);
         if (idle_starttime > 0 && simulation->is_warmup_done()){
             output_thd_idle_time[td_id] += get_sys_clock() - idle_starttime;
@@ -78,9 +189,8 @@ void MessageThread::run()
     } 
 #endif
 
-    // dest = msg_queue.dequeue(get_thd_id(), allsign, msg);
-    msg_queue.dequeue(get_thd_id(), allsign, msg);
-    if (!msg)
+    msg_entry *entry = msg_queue.dequeue(get_thd_id());
+    if (!entry)
     {
         check_and_send_batches();
         if (idle_starttime == 0)
@@ -96,8 +206,24 @@ void MessageThread::run()
         idle_starttime = 0;
     }
 #endif
+    msg = entry->msg;
     assert(msg);
 
+#if SG_SEND
+    // Large broadcasts are serialized once; only the header differs per destination.
+    char *sg_body = NULL;
+    uint64_t sg_body_len = 0;
+    if (ISSERVER && msg->dest.size() > 1 && msg->get_size() >= SG_SEND_THRESHOLD)
+    {
+        uint64_t head_size = msg->mget_size();
+        uint64_t size = msg->get_size();
+        assert(size <= g_msg_size);
+        msg->copy_to_buf(sg_buf);
+        sg_body = sg_buf + head_size;
+        sg_body_len = size - head_size;
+    }
+#endif
+
     // for (uint64_t i = 0; i < dest.size(); i++)
     for (uint64_t i = 0; i < msg->dest.size(); i++)
     {
@@ -111,9 +237,9 @@ void MessageThread::run()
             }
         }
         // Adding signature, if present.
-        if (allsign.size() > 0)
+        if (entry->sign_cnt > 0)
         {
-            msg->signature = allsign[i];
+            msg->signature.assign(entry->get_sign(i), entry->sign_len);
             switch (msg->rtype)
             {
             case CL_BATCH:
@@ -137,6 +263,13 @@ void MessageThread::run()
             msg->sigSize = msg->signature.size();
             msg->keySize = msg->pubKey.size();
         }
+#if SG_SEND
+        if (sg_body != NULL)
+        {
+            send_gathered(msg, dest_node_id, sg_body, sg_body_len);
+            continue;
+        }
+#endif
         sbuf = buffer[dest_node_id];
         if (!sbuf->fits(msg->get_size()))
         {
@@ -153,6 +286,17 @@ void MessageThread::run()
         if (msg->rtype == PBFT_CHKPT_MSG){
             sbuf->force = true;
         }
+#if VOTE_BUNDLE
+        else if (msg->rtype == HOTSTUFF_NEW_VIEW_MSG)
+        {
+            // Hold the vote so that votes of other instances share its frame.
+            if (!sbuf->bundled)
+            {
+                sbuf->bundled = true;
+                bundle_pending++;
+            }
+        }
+#endif
 #if PVP_FORCE
         else if(msg->rtype == HOTSTUFF_GENERIC_MSG){
              sbuf->force = true;
@@ -163,10 +307,16 @@ void MessageThread::run()
         msg->copy_to_buf(&(sbuf->buffer[sbuf->ptr]));
         sbuf->cnt += 1;
         sbuf->ptr += msg->get_size();
+#if ADAPTIVE_FLUSH
+        if (sbuf->cnt == 1)
+            held_cnt++;
+        sbuf->track(get_sys_clock());
+#endif
 
         if (sbuf->starttime == 0)
             sbuf->starttime = get_sys_clock();
         check_and_send_batches();
     }
     Message::release_message(msg);
+    msg_queue.free_entry(entry);
 }
@@ -4,6 +4,11 @@
 #include "global.h"
 #include "nn.hpp"
 
+class Message;
+
+// Room reserved at the end of a frame for the vote bundle MAC and its length.
+#define VOTE_BUNDLE_TRAILER 64
+
 struct mbuf
 {
     char *buffer;
@@ -13,17 +18,39 @@ struct mbuf
     bool wait;
     uint64_t dest_node_id;
     bool force = false;
+#if VOTE_BUNDLE
+    // Frame carries votes and is sealed with a single MAC in send_batch.
+    bool bundled = false;
+#endif
+#if ADAPTIVE_FLUSH
+    // Time of the last message to this destination and EWMA of the gaps.
+    uint64_t last_time;
+    double gap_ewma;
+    // Sum of the insertion times of the messages held in the buffer.
+    uint64_t enq_sum;
+#endif
 
     void init(uint64_t dest_id)
     {
         buffer = (char *)nng_alloc(g_msg_size);
         dest_node_id = dest_id;
+        force = false;
+#if ADAPTIVE_FLUSH
+        last_time = 0;
+        gap_ewma = MBUF_MAX_AGE;
+#endif
     }
     void reset(uint64_t dest_id)
     {
         starttime = 0;
         cnt = 0;
         wait = false;
+#if VOTE_BUNDLE
+        bundled = false;
+#endif
+#if ADAPTIVE_FLUSH
+        enq_sum = 0;
+#endif
         ((uint32_t *)buffer)[0] = dest_id;
         ((uint32_t *)buffer)[1] = g_node_id;
         ptr = sizeof(uint32_t) * 3;
@@ -38,11 +65,50 @@ struct mbuf
     }
     bool fits(uint64_t s)
     {
+#if VOTE_BUNDLE
+        // Leave room for the MAC trailer of a bundled frame.
+        s += VOTE_BUNDLE_TRAILER;
+#endif
+#if ADAPTIVE_FLUSH
+        // Cap frames by bytes, but a single large message still gets its own frame.
+        if (cnt > 0 && (ptr + s) > MBUF_FLUSH_BYTES)
+            return false;
+#endif
         return (ptr + s) <= g_msg_size;
     }
+#if ADAPTIVE_FLUSH
+    void track(uint64_t now)
+    {
+        if (last_time > 0)
+            gap_ewma = gap_ewma * (1 - MBUF_GAP_ALPHA) + (now - last_time) * MBUF_GAP_ALPHA;
+        last_time = now;
+        enq_sum += now;
+    }
+#endif
     bool ready()
     {
-#if CONSENSUS == HOTSTUFF
+#if ADAPTIVE_FLUSH
+        if (cnt == 0)
+            return false;
+        if (!simulation->is_warmup_done() || !ISSERVER)
+            return true;
+        if (force || cnt >= MESSAGE_PER_BUFFER || ptr >= MBUF_FLUSH_BYTES)
+        {
+            force = false;
+            return true;
+        }
+        uint64_t now = get_sys_clock();
+#if VOTE_BUNDLE
+        if (bundled)
+            return (now - starttime) >= VOTE_BUNDLE_WAIT;
+#endif
+        // Flush when old enough, or when the next message to this destination
+        // is not expected soon given its recent send rate.
+        double hold = 2 * gap_ewma > MBUF_MIN_HOLD ? 2 * gap_ewma : MBUF_MIN_HOLD;
+        if ((now - starttime) >= MBUF_MAX_AGE || gap_ewma >= MBUF_MAX_AGE || (now - last_time) >= hold)
+            return true;
+        return false;
+#elif CONSENSUS == HOTSTUFF
     #if PVP_FORCE
         if (simulation->is_warmup_done() && ISSERVER)
         {
@@ -51,6 +117,10 @@ struct mbuf
                 // printf("%lu\n",cnt);
                 return true;
             }
+#if VOTE_BUNDLE
+            if (bundled && cnt && (get_sys_clock() - starttime) >= VOTE_BUNDLE_WAIT)
+                return true;
+#endif
             return false;
         }
         else{
@@ -93,6 +163,10 @@ public:
     void run();
     void check_and_send_batches();
     void send_batch(uint64_t dest_node_id);
+    uint64_t flush_timeout();
+#if SG_SEND
+    void send_gathered(Message *msg, uint64_t dest_node_id, char *body, uint64_t body_len);
+#endif
     void copy_to_buffer(mbuf *sbuf, RemReqType type, BaseQuery *qry);
     uint64_t get_msg_size(RemReqType type, BaseQuery *qry);
     void rack(mbuf *sbuf, BaseQuery *qry);
@@ -113,6 +187,19 @@ public:
 
 private:
     mbuf **buffer;
+#if VOTE_BUNDLE
+    // Number of mbufs holding votes that are waiting for the bundle window.
+    uint64_t bundle_pending = 0;
+#endif
+#if SG_SEND
+    // Payload serialized once per broadcast and per-destination header.
+    char *sg_buf;
+    char *sg_head;
+#endif
+#if ADAPTIVE_FLUSH
+    // Number of non-empty mbufs.
+    uint64_t held_cnt = 0;
+#endif
     uint64_t buffer_cnt;
     uint64_t _thd_id;
 };
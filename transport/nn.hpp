@@ -93,6 +93,19 @@ namespace nn
             return rc;
         }
 
+        // On success nng owns msg, otherwise it remains with the caller.
+        inline int sendmsg(nng_msg *msg, int flags)
+        {
+            int rc = nng_sendmsg(s, msg, flags);
+            if (nn_slow(rc != 0))
+            {
+                if (nn_slow(rc != NNG_EAGAIN))
+                    throw nn::exception(rc);
+                return -1;
+            }
+            return rc;
+        }
+
         inline int recv(void **buf, int flags)
         {
             size_t len;
@@ -118,6 +131,15 @@ namespace nn
             }
         }
 
+        inline void pipe_notify(nng_pipe_ev ev, nng_pipe_cb cb, void *arg)
+        {
+            int rc;
+            if ((rc = nng_pipe_notify(s, ev, cb, arg)) != 0)
+            {
+                throw nn::exception(rc);
+            }
+        }
+
         nng_socket s;
 
     private:
@@ -0,0 +1,150 @@
+#include "shm_ring.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if SHM_TRANSPORT
+
+#define SHM_WRAP UINT32_MAX
+#define SHM_RING_MASK (SHM_RING_SIZE - 1)
+#define SHM_STALE_CHECK 4096 // empty polls between checks for a replaced segment
+
+static inline uint64_t record_size(uint64_t size)
+{
+    return (sizeof(uint32_t) + size + 7) & ~(uint64_t)7;
+}
+
+bool ShmRing::map(int flags)
+{
+    int fd = shm_open(name.c_str(), flags, 0600);
+    if (fd < 0)
+        return false;
+    uint64_t len = sizeof(Header) + SHM_RING_SIZE;
+    if ((flags & O_CREAT) && ftruncate(fd, len) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < len)
+    {
+        // Created but not sized yet by the producer.
+        ::close(fd);
+        return false;
+    }
+    void *addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+    seg_fd = fd;
+    hdr = (Header *)addr;
+    data = (char *)addr + sizeof(Header);
+    return true;
+}
+
+bool ShmRing::create()
+{
+    assert((SHM_RING_SIZE & SHM_RING_MASK) == 0);
+    shm_unlink(name.c_str());
+    if (!map(O_RDWR | O_CREAT | O_EXCL))
+    {
+        printf("Shm Create Error: %s %d %s\n", name.c_str(), errno, strerror(errno));
+        return false;
+    }
+    owner = true;
+    return true;
+}
+
+bool ShmRing::attach()
+{
+    if (!map(O_RDWR))
+        return false;
+    cached_head = hdr->head.load(std::memory_order_acquire);
+    return true;
+}
+
+void ShmRing::close()
+{
+    if (hdr)
+    {
+        munmap(hdr, sizeof(Header) + SHM_RING_SIZE);
+        ::close(seg_fd);
+        hdr = NULL;
+        data = NULL;
+        seg_fd = -1;
+    }
+    if (owner)
+    {
+        shm_unlink(name.c_str());
+        owner = false;
+    }
+}
+
+bool ShmRing::push(const nng_iov *iov, uint64_t iov_cnt, uint64_t size)
+{
+    uint64_t need = record_size(size);
+    assert(need <= SHM_RING_SIZE / 2);
+    uint64_t head = hdr->head.load(std::memory_order_relaxed);
+    uint64_t off = head & SHM_RING_MASK;
+    uint64_t skip = off + need > SHM_RING_SIZE ? SHM_RING_SIZE - off : 0;
+    if (head + skip + need - cached_tail > SHM_RING_SIZE)
+    {
+        cached_tail = hdr->tail.load(std::memory_order_acquire);
+        if (head + skip + need - cached_tail > SHM_RING_SIZE)
+            return false;
+    }
+    if (skip)
+    {
+        *(uint32_t *)&data[off] = SHM_WRAP;
+        head += skip;
+        off = 0;
+    }
+    *(uint32_t *)&data[off] = size;
+    char *ptr = &data[off + sizeof(uint32_t)];
+    for (uint64_t i = 0; i < iov_cnt; i++)
+    {
+        memcpy(ptr, iov[i].iov_buf, iov[i].iov_len);
+        ptr += iov[i].iov_len;
+    }
+    hdr->head.store(head + need, std::memory_order_release);
+    return true;
+}
+
+char *ShmRing::front(uint64_t &size)
+{
+    uint64_t tail = hdr->tail.load(std::memory_order_relaxed);
+    if (tail == cached_head)
+    {
+        cached_head = hdr->head.load(std::memory_order_acquire);
+        if (tail == cached_head)
+        {
+            // A segment left over by an earlier run is replaced when the
+            // producer starts; let go of it so that the new one is attached.
+            struct stat st;
+            if (!owner && ++idle_polls % SHM_STALE_CHECK == 0 && fstat(seg_fd, &st) == 0 && st.st_nlink == 0)
+                close();
+            return NULL;
+        }
+    }
+    uint64_t off = tail & SHM_RING_MASK;
+    uint32_t len = *(uint32_t *)&data[off];
+    if (len == SHM_WRAP)
+    {
+        // The producer publishes the wrap and the frame after it together.
+        tail += SHM_RING_SIZE - off;
+        off = 0;
+        len = *(uint32_t *)&data[0];
+    }
+    size = len;
+    next_tail = tail + record_size(len);
+    return &data[off + sizeof(uint32_t)];
+}
+
+void ShmRing::pop()
+{
+    hdr->tail.store(next_tail, std::memory_order_release);
+}
+
+#endif
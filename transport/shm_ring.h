@@ -0,0 +1,64 @@
+#ifndef _SHM_RING_H_
+#define _SHM_RING_H_
+
+#include "global.h"
+#include "nn.hpp"
+#include <atomic>
+
+#if SHM_TRANSPORT
+/*
+    Single-producer single-consumer ring of frames in a POSIX shared memory
+    segment, used between two nodes on the same host. The sending side owns
+    the segment: it replaces any leftover segment of the same name when it
+    creates the ring and removes it on release. The receiving side attaches
+    once the segment exists.
+
+    Frames are stored as [uint32 len][frame], padded to 8 bytes, and never
+    straddle the end of the ring; a SHM_WRAP length sends the reader back to
+    the start.
+*/
+class ShmRing
+{
+public:
+    ShmRing(const string &name) : name(name) { claimed.clear(); }
+    ~ShmRing() { close(); }
+
+    bool create();
+    bool attach();
+    bool is_attached() { return hdr != NULL; }
+    void close();
+
+    // Copies a frame into the ring. Returns false if there is no room yet.
+    bool push(const nng_iov *iov, uint64_t iov_cnt, uint64_t size);
+    // Returns the oldest frame in place, or NULL; pop() releases it. May
+    // detach from a segment that was replaced.
+    char *front(uint64_t &size);
+    void pop();
+
+    // Input threads that share a ring take turns reading it.
+    bool try_claim() { return !claimed.test_and_set(std::memory_order_acquire); }
+    void unclaim() { claimed.clear(std::memory_order_release); }
+
+private:
+    struct Header
+    {
+        alignas(CL_SIZE) std::atomic<uint64_t> head; // Written by the producer
+        alignas(CL_SIZE) std::atomic<uint64_t> tail; // Written by the consumer
+    };
+    bool map(int flags);
+
+    string name;
+    int seg_fd = -1;
+    bool owner = false;
+    Header *hdr = NULL;
+    char *data = NULL;
+    // Local copies of the other side's position, refreshed only when needed.
+    uint64_t cached_tail = 0;
+    uint64_t cached_head = 0;
+    uint64_t next_tail = 0;
+    uint64_t idle_polls = 0;
+    std::atomic_flag claimed;
+};
+#endif
+
+#endif
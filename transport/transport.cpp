@@ -138,9 +138,23 @@ Socket *Transport::bind(uint64_t port_id)
     return socket;
 }
 
-Socket *Transport::connect(uint64_t dest_id, uint64_t port_id)
+#if QUORUM_START
+static void peer_connected(nng_pipe pipe, nng_pipe_ev ev, void *arg)
+{
+    ((PeerLink *)arg)->ready.store(true, std::memory_order_release);
+}
+#endif
+
+Socket *Transport::connect(uint64_t dest_id, uint64_t port_id, PeerLink *peer)
 {
     Socket *socket = get_socket();
+#if QUORUM_START
+    // Dials run in the background; readiness comes from the pipe callback.
+    if (peer)
+        socket->sock.pipe_notify(NNG_PIPE_EV_ADD_POST, peer_connected, peer);
+    socket->sock.setsockopt_ms(NNG_OPT_RECONNMINT, REDIAL_MIN_MS);
+    socket->sock.setsockopt_ms(NNG_OPT_RECONNMAXT, REDIAL_MAX_MS);
+#endif
     char socket_name[MAX_TPORT_NAME];
 #if TPORT_TYPE == IPC
     sprintf(socket_name, "ipc://node_%ld.ipc", port_id);
@@ -178,6 +192,57 @@ void Transport::init()
     string path = get_path();
     read_ifconfig(path.c_str());
 
+    peers = new PeerLink[g_total_node_cnt * g_this_send_thread_cnt];
+#if WIRE_COMPRESS
+    pack_bufs = new std::vector<char>[g_this_send_thread_cnt];
+#endif
+#if LINK_STATS
+    link_echo = new LinkEcho[g_total_node_cnt];
+#endif
+#if SEND_BACKPRESSURE || QUORUM_START
+    parked_peers = new uint64_t[g_this_send_thread_cnt]();
+#endif
+#if IO_URING_TRANSPORT
+    send_rings = new URing[g_this_send_thread_cnt];
+    inflight_peers = new uint64_t[g_this_send_thread_cnt]();
+    for (uint64_t i = 0; i < g_this_send_thread_cnt; i++)
+    {
+        if (!send_rings[i].init(URING_DEPTH))
+            assert(false);
+    }
+    if (!ISSERVER)
+    {
+        for (uint64_t i = 0; i < g_this_rem_thread_cnt; i++)
+            uring_recvs.push_back(new UringReceiver);
+    }
+    else
+    {
+        uring_recv_clients = new UringReceiver;
+        uring_recvs.push_back(uring_recv_clients);
+        for (uint64_t i = 0; i < g_rem_thread_cnt - 1; i++)
+        {
+            uring_recv_servers[i] = new UringReceiver;
+            uring_recvs.push_back(uring_recv_servers[i]);
+        }
+    }
+    for (uint64_t i = 0; i < uring_recvs.size(); i++)
+    {
+        if (!uring_recvs[i]->ring.init(URING_DEPTH))
+            assert(false);
+    }
+#if ENVIRONMENT_EC2
+    const char *listen_addr = "0.0.0.0";
+#else
+    const char *listen_addr = ifaddr[g_node_id];
+#endif
+#endif
+#if RECORD_REPLAY
+    open_frame_logs();
+    // A replica fed from logs has no peers; what it sends goes nowhere.
+    if (replaying)
+        return;
+#endif
+
     for (uint64_t node_id = 0; node_id < g_total_node_cnt; node_id++)
     {
         if (node_id == g_node_id)
@@ -194,9 +259,24 @@ void Transport::init()
                 {
                     continue;
                 }
-                uint64_t port_id = get_port_id(node_id, g_node_id, c_thd_id);
 #else
-                uint64_t port_id = get_port_id(node_id, g_node_id, client_thread_id % g_client_send_thread_cnt);
+                uint64_t c_thd_id = client_thread_id % g_client_send_thread_cnt;
+#endif
+#if SHM_TRANSPORT
+                if (is_colocated(node_id))
+                {
+                    ShmRing *ring = new ShmRing(get_ring_name(node_id, g_node_id, c_thd_id));
+                    if (!ISSERVER)
+                        recv_rings.push_back(ring);
+                    else
+                        recv_rings_clients.push_back(ring);
+                    continue;
+                }
+#endif
+                uint64_t port_id = get_port_id(node_id, g_node_id, c_thd_id);
+#if IO_URING_TRANSPORT
+                get_receiver(node_id)->add_listener(uring_listen(listen_addr, port_id));
+                continue;
 #endif
                 Socket *sock = bind(port_id);
                 if (!ISSERVER)
@@ -220,8 +300,33 @@ void Transport::init()
                 {
                     continue;
                 }
+#endif
+#if SHM_TRANSPORT
+                if (is_colocated(node_id))
+                {
+                    ShmRing *ring = new ShmRing(get_ring_name(node_id, g_node_id, server_thread_id));
+                    if (!ISSERVER)
+                    {
+                        recv_rings.push_back(ring);
+                    }
+                    else
+                    {
+                    #if INPUT_OP
+                        for(uint64_t ithd = 0; ithd < g_rem_thread_cnt - 1; ithd++){
+                            recv_rings_servers[ithd].push_back(ring);
+                        }
+                    #else
+                        recv_rings_servers[node_id % (g_rem_thread_cnt - 1)].push_back(ring);
+                    #endif
+                    }
+                    continue;
+                }
 #endif
                 uint64_t port_id = get_port_id(node_id, g_node_id, server_thread_id);
+#if IO_URING_TRANSPORT
+                get_receiver(node_id)->add_listener(uring_listen(listen_addr, port_id));
+                continue;
+#endif
                 Socket *sock = bind(port_id);
                 // Sockets for clients and servers in different sets.
                 if (!ISSERVER)
@@ -252,13 +357,26 @@ void Transport::init()
                 {
                     continue;
                 }
-                uint64_t port_id = get_port_id(g_node_id, node_id, c_thd_id);
 #else
-                uint64_t port_id = get_port_id(g_node_id, node_id, client_thread_id % g_client_send_thread_cnt);
+                uint64_t c_thd_id = client_thread_id % g_client_send_thread_cnt;
+#endif
+#if SHM_TRANSPORT
+                if (is_colocated(node_id))
+                {
+                    ShmRing *ring = new ShmRing(get_ring_name(g_node_id, node_id, c_thd_id));
+                    if (!ring->create())
+                        assert(false);
+                    peers[get_peer_index(node_id, client_thread_id)].ring = ring;
+                    continue;
+                }
 #endif
-                std::pair<uint64_t, uint64_t> sender = std::make_pair(node_id, client_thread_id);
-                Socket *sock = connect(node_id, port_id);
-                send_sockets.insert(std::make_pair(sender, sock));
+                uint64_t port_id = get_port_id(g_node_id, node_id, c_thd_id);
+#if IO_URING_TRANSPORT
+                uring_dials.push_back({get_peer_index(node_id, client_thread_id), node_id, port_id});
+                continue;
+#endif
+                Socket *sock = connect(node_id, port_id, &peers[get_peer_index(node_id, client_thread_id)]);
+                peers[get_peer_index(node_id, client_thread_id)].sock = sock;
                 DEBUG("Socket insert: {%ld,%ld}: %ld\n", node_id, client_thread_id, (uint64_t)sock);
             }
         }
@@ -272,18 +390,59 @@ void Transport::init()
                 {
                     continue;
                 }
-                uint64_t port_id = get_port_id(g_node_id, node_id, s_thd_id);
 #else
-                uint64_t port_id = get_port_id(g_node_id, node_id, server_thread_id % g_send_thread_cnt);
+                uint64_t s_thd_id = server_thread_id % g_send_thread_cnt;
 #endif
-                std::pair<uint64_t, uint64_t> sender = std::make_pair(node_id, server_thread_id);
-                Socket *sock = connect(node_id, port_id);
-                send_sockets.insert(std::make_pair(sender, sock));
+#if SHM_TRANSPORT
+                if (is_colocated(node_id))
+                {
+                    ShmRing *ring = new ShmRing(get_ring_name(g_node_id, node_id, s_thd_id));
+                    if (!ring->create())
+                        assert(false);
+                    peers[get_peer_index(node_id, server_thread_id)].ring = ring;
+                    continue;
+                }
+#endif
+                uint64_t port_id = get_port_id(g_node_id, node_id, s_thd_id);
+#if IO_URING_TRANSPORT
+                uring_dials.push_back({get_peer_index(node_id, server_thread_id), node_id, port_id});
+                continue;
+#endif
+                Socket *sock = connect(node_id, port_id, &peers[get_peer_index(node_id, server_thread_id)]);
+                peers[get_peer_index(node_id, server_thread_id)].sock = sock;
                 DEBUG("Socket insert: {%ld,%ld}: %ld\n", node_id, server_thread_id, (uint64_t)sock);
             }
         }
     }
 
+#if REBALANCE_INPUT
+    // Start from the static split: clients to input thread 0, replicas by id.
+    if (ISSERVER)
+    {
+        for (uint64_t i = 0; i < recv_sockets_clients.size(); i++)
+            add_sock_load(recv_sockets_clients[i], 0);
+        for (uint64_t abs_tid = 0; abs_tid < g_rem_thread_cnt - 1; abs_tid++)
+        {
+            for (uint64_t i = 0; i < recv_sockets_servers[abs_tid].size(); i++)
+                add_sock_load(recv_sockets_servers[abs_tid][i], abs_tid == 0 ? g_rem_thread_cnt - 1 : abs_tid);
+        }
+        for (uint64_t t = 0; t < g_rem_thread_cnt; t++)
+            refresh_view(t);
+    }
+#endif
+#if IO_URING_TRANSPORT
+    // Every node listens before it dials and connections wait in the backlog
+    // until accepted, so no node can hold up another here.
+    for (uint64_t i = 0; i < uring_dials.size(); i++)
+    {
+        UringDial &d = uring_dials[i];
+        peers[d.peer_idx].fd = uring_connect(ifaddr[g_node_id], ifaddr[d.node_id], d.port_id);
+    }
+    uring_dials.clear();
+    for (uint64_t i = 0; i < uring_recvs.size(); i++)
+        uring_recvs[i]->accept_all();
+#endif
+
     fflush(stdout);
 }
 
@@ -295,84 +454,984 @@ void Transport::release() {
          delete ifaddr;
          ifaddr = nullptr;
      }
+     if(peers){
+         for(uint64_t i = 0; i < g_total_node_cnt * g_this_send_thread_cnt; ++i){
+             while(!peers[i].parked.empty()){
+                 nng_msg_free(peers[i].parked.front());
+                 peers[i].parked.pop_front();
+             }
+#if SHM_TRANSPORT
+             delete peers[i].ring;
+#endif
+#if IO_URING_TRANSPORT
+             drop_sends(&peers[i], i / g_total_node_cnt);
+             if(peers[i].fd >= 0)
+                 close(peers[i].fd);
+#endif
+         }
+         delete[] peers;
+         peers = nullptr;
+     }
+#if LINK_STATS
+     delete[] link_echo;
+     link_echo = nullptr;
+#endif
+#if WIRE_COMPRESS
+     delete[] pack_bufs;
+     pack_bufs = nullptr;
+#endif
+#if RECORD_REPLAY
+     if(frame_logs){
+         for(uint64_t i = 0; i < g_this_rem_thread_cnt; ++i){
+             if(frame_logs[i].file)
+                 fclose(frame_logs[i].file);
+         }
+         delete[] frame_logs;
+         frame_logs = nullptr;
+     }
+#endif
+#if SHM_TRANSPORT
+     for(uint64_t i = 0; i < recv_rings.size(); ++i)
+         delete recv_rings[i];
+     for(uint64_t i = 0; i < recv_rings_clients.size(); ++i)
+         delete recv_rings_clients[i];
+     // Rings shared by all input threads are listed once per thread.
+     std::set<ShmRing *> server_rings;
+     for(uint64_t t = 0; t < REM_THREAD_CNT - 1; ++t)
+         server_rings.insert(recv_rings_servers[t].begin(), recv_rings_servers[t].end());
+     for(auto it = server_rings.begin(); it != server_rings.end(); ++it)
+         delete *it;
+     recv_rings.clear();
+     recv_rings_clients.clear();
+     for(uint64_t t = 0; t < REM_THREAD_CNT - 1; ++t)
+         recv_rings_servers[t].clear();
+#endif
+#if REBALANCE_INPUT
+     for(uint64_t i = 0; i < sock_loads.size(); ++i)
+         delete sock_loads[i];
+     sock_loads.clear();
+#endif
+#if IO_URING_TRANSPORT
+     delete[] send_rings;
+     send_rings = nullptr;
+     for(uint64_t i = 0; i < uring_recvs.size(); ++i)
+         delete uring_recvs[i];
+     uring_recvs.clear();
+     uring_recv_clients = nullptr;
+     for(uint64_t t = 0; t < REM_THREAD_CNT - 1; ++t)
+         uring_recv_servers[t] = nullptr;
+#endif
  }
 
 // rename sid to send thread id
 void Transport::send_msg(uint64_t send_thread_id, uint64_t dest_node_id, void *sbuf, int size)
 {
+    nng_iov iov;
+    iov.iov_buf = sbuf;
+    iov.iov_len = size;
+    send_msg_iov(send_thread_id, dest_node_id, &iov, 1);
+}
+
+// Index of the send state of dest_node_id for the given output thread. Slots of
+// one output thread are contiguous as only that thread touches them.
+uint64_t Transport::get_peer_index(uint64_t dest_node_id, uint64_t send_thread_id)
+{
+    uint64_t send_base = ISCLIENT ? g_client_thread_cnt + g_client_rem_thread_cnt : g_thread_cnt + g_rem_thread_cnt;
+    return (send_thread_id - send_base) * g_total_node_cnt + dest_node_id;
+}
+
+#if SHM_TRANSPORT
+// Nodes listed with the same address in ifconfig share a host.
+bool Transport::is_colocated(uint64_t node_id)
+{
+    return strcmp(ifaddr[node_id], ifaddr[g_node_id]) == 0;
+}
+
+string Transport::get_ring_name(uint64_t src_node_id, uint64_t dest_node_id, uint64_t send_thread_id)
+{
+    char name[MAX_TPORT_NAME];
+    sprintf(name, "/rdb_%d_%ld_%ld_%ld", TPORT_PORT, src_node_id, dest_node_id, send_thread_id);
+    return string(name);
+}
+
+void Transport::send_ring(PeerLink *peer, uint64_t send_thread_id, uint64_t dest_node_id, const nng_iov *iov, uint64_t iov_cnt, uint64_t size)
+{
+    uint64_t starttime = get_sys_clock();
+    INC_GLOB_STATS_ARR(bytes_sent, dest_node_id, size);
+    if (peer->failed)
+        return;
+    // Like a blocking socket send, wait for the reader to make room.
+    if (!peer->ring->push(iov, iov_cnt, size))
+    {
+#if LINK_STATS
+        uint64_t blocked = get_sys_clock();
+#endif
+        while (!peer->ring->push(iov, iov_cnt, size))
+        {
+            if (simulation->is_setup_done() && simulation->is_done())
+                return;
+        }
+        INC_LINK_STATS(send_thread_id, dest_node_id, send_blocked_time, get_sys_clock() - blocked);
+    }
+    DEBUG("%ld Batch of %ld bytes put in ring of node %ld\n", send_thread_id, size, dest_node_id);
+    INC_STATS(send_thread_id, msg_send_time, get_sys_clock() - starttime);
+    INC_STATS(send_thread_id, msg_send_cnt, 1);
+}
+
+std::vector<Message *> *Transport::recv_ring(uint64_t thd_id)
+{
+    std::vector<ShmRing *> *rings;
+    if (!ISSERVER)
+        rings = &recv_rings;
+    else if (thd_id % g_this_rem_thread_cnt == 0)
+        rings = &recv_rings_clients;
+    else
+        rings = &recv_rings_servers[thd_id % (g_rem_thread_cnt - 1)];
+    if (rings->empty())
+        return NULL;
+
     uint64_t starttime = get_sys_clock();
+    uint64_t start = starttime % rings->size();
+    for (uint64_t i = 0; i < rings->size(); i++)
+    {
+        ShmRing *ring = (*rings)[(start + i) % rings->size()];
+        if (!ring->try_claim())
+            continue;
+        uint64_t size = 0;
+        char *buf = NULL;
+        if (ring->is_attached() || ring->attach())
+            buf = ring->front(size);
+        if (buf == NULL)
+        {
+            ring->unclaim();
+            continue;
+        }
+
+        INC_STATS(thd_id, msg_recv_time, get_sys_clock() - starttime);
+        INC_STATS(thd_id, msg_recv_cnt, 1);
+        std::vector<Message *> *msgs = unpack(thd_id, buf, size);
+        ring->pop();
+        ring->unclaim();
+        if (msgs->empty())
+        {
+            delete msgs;
+            return NULL;
+        }
+        DEBUG("Batch of %ld bytes recv from ring of node %ld\n", size, msgs->front()->return_node_id);
+        INC_GLOB_STATS_ARR(bytes_received, msgs->front()->return_node_id, size);
+        return msgs;
+    }
+    return NULL;
+}
+#endif
+
+#if IO_URING_TRANSPORT
+// Input thread that reads from node_id, mirroring how the sockets are split.
+UringReceiver *Transport::get_receiver(uint64_t node_id)
+{
+    if (!ISSERVER)
+        return uring_recvs[uring_recv_cnt++ % g_this_rem_thread_cnt];
+    if (ISCLIENTN(node_id))
+        return uring_recv_clients;
+    // With INPUT_OP a connection still has a single reader.
+    return uring_recv_servers[node_id % (g_rem_thread_cnt - 1)];
+}
 
-    Socket *socket = send_sockets.find(std::make_pair(dest_node_id, send_thread_id))->second;
-    // Copy messages to nanomsg buffer
-    // void *buf = nn_allocmsg(size, 0);
-    // memcpy(buf, sbuf, size);
-    DEBUG("%ld Sending batch of %d bytes to node %ld on socket %ld\n", send_thread_id, size, dest_node_id, (uint64_t)socket);
+void Transport::send_uring(PeerLink *peer, uint64_t send_thread_id, uint64_t dest_node_id, const nng_iov *iov, uint64_t iov_cnt, uint64_t size)
+{
+    uint64_t starttime = get_sys_clock();
     INC_GLOB_STATS_ARR(bytes_sent, dest_node_id, size);
+    if (peer->failed)
+        return;
+    uint64_t peer_idx = get_peer_index(dest_node_id, send_thread_id);
+    uint64_t rel_thd = peer_idx / g_total_node_cnt;
+    // A peer that is not draining holds at most PEER_SENDQ_LEN frames.
+#if LINK_STATS
+    uint64_t blocked = get_sys_clock();
+#endif
+    while (peer->sendq.size() >= PEER_SENDQ_LEN)
+    {
+        if (simulation->is_setup_done() && simulation->is_done())
+            return;
+        uint64_t enters = send_rings[rel_thd].enter_cnt;
+        send_rings[rel_thd].submit(1, URING_WAIT);
+        INC_STATS(send_thread_id, msg_uring_enter_cnt, send_rings[rel_thd].enter_cnt - enters);
+        reap_sends(send_thread_id);
+        if (peer->failed)
+            return;
+    }
+    INC_LINK_STATS(send_thread_id, dest_node_id, send_blocked_time, get_sys_clock() - blocked);
 
-#if VIEW_CHANGES || LOCAL_FAULT || PVP_RECOVERY
-    bool failednode = false;
+    // The frame is copied, since the caller reuses its buffers as soon as
+    // this returns and the send completes later.
+    uint64_t len = sizeof(uint32_t) + size;
+    char *frame = (char *)mem_allocator.alloc(len);
+    uint32_t frame_size = size;
+    memcpy(frame, &frame_size, sizeof(frame_size));
+    char *body = frame + sizeof(frame_size);
+    for (uint64_t i = 0; i < iov_cnt; i++)
+    {
+        memcpy(body, iov[i].iov_buf, iov[i].iov_len);
+        body += iov[i].iov_len;
+    }
+    peer->sendq.push_back(make_pair(frame, len));
+    // Queued only; flush_sends() submits all new sends of the thread at once.
+    if (peer->sendq.size() == 1)
+    {
+        inflight_peers[rel_thd]++;
+        submit_send(&send_rings[rel_thd], peer, peer_idx);
+    }
+    DEBUG("%ld Batch of %ld bytes queued for node %ld\n", send_thread_id, size, dest_node_id);
+    INC_STATS(send_thread_id, msg_send_time, get_sys_clock() - starttime);
+    INC_STATS(send_thread_id, msg_send_cnt, 1);
+}
+
+// One send per peer is in flight, which keeps the frames of a peer in order.
+void Transport::submit_send(URing *ring, PeerLink *peer, uint64_t peer_idx)
+{
+    struct io_uring_sqe *sqe;
+    while ((sqe = ring->get_sqe()) == NULL)
+        ring->submit();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = peer->fd;
+    sqe->addr = (uint64_t)(peer->sendq.front().first + peer->sent);
+    sqe->len = peer->sendq.front().second - peer->sent;
+    sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+    sqe->user_data = peer_idx;
+}
+
+void Transport::drop_sends(PeerLink *peer, uint64_t rel_thd)
+{
+    if (peer->sendq.empty())
+        return;
+    while (!peer->sendq.empty())
+    {
+        mem_allocator.free(peer->sendq.front().first, peer->sendq.front().second);
+        peer->sendq.pop_front();
+    }
+    peer->sent = 0;
+    inflight_peers[rel_thd]--;
+}
 
+void Transport::reap_sends(uint64_t send_thread_id)
+{
+    uint64_t rel_thd = get_peer_index(0, send_thread_id) / g_total_node_cnt;
+    URing *ring = &send_rings[rel_thd];
+    struct io_uring_cqe *cqe;
+    while ((cqe = ring->peek_cqe()) != NULL)
+    {
+        uint64_t peer_idx = cqe->user_data;
+        int res = cqe->res;
+        ring->cqe_seen();
+        PeerLink *peer = &peers[peer_idx];
+        if (res == 0 || (res < 0 && res != -EAGAIN && res != -EINTR))
+        {
+            drop_sends(peer, rel_thd);
+            mark_failed_node(peer_idx % g_total_node_cnt);
+            continue;
+        }
+        if (res > 0)
+            peer->sent += res;
+        if (peer->sent == peer->sendq.front().second)
+        {
+            mem_allocator.free(peer->sendq.front().first, peer->sendq.front().second);
+            peer->sendq.pop_front();
+            peer->sent = 0;
+        }
+        if (peer->sendq.empty())
+            inflight_peers[rel_thd]--;
+        else
+            submit_send(ring, peer, peer_idx);
+    }
+}
+
+// Submits the sends queued since the last call in one system call and
+// starts the next frame of every peer whose send completed.
+void Transport::flush_sends(uint64_t send_thread_id)
+{
+    URing *ring = &send_rings[get_peer_index(0, send_thread_id) / g_total_node_cnt];
+    uint64_t enters = ring->enter_cnt;
+    ring->submit();
+    reap_sends(send_thread_id);
+    ring->submit();
+    INC_STATS(send_thread_id, msg_uring_enter_cnt, ring->enter_cnt - enters);
+}
+
+bool Transport::has_inflight(uint64_t send_thread_id)
+{
+    return inflight_peers[get_peer_index(0, send_thread_id) / g_total_node_cnt] > 0;
+}
+
+std::vector<Message *> *Transport::recv_uring(uint64_t thd_id)
+{
+    UringReceiver *recv;
+    if (!ISSERVER)
+        recv = uring_recvs[thd_id % g_this_rem_thread_cnt];
+    else if (thd_id % g_this_rem_thread_cnt == 0)
+        recv = uring_recv_clients;
+    else
+        recv = uring_recv_servers[thd_id % (g_rem_thread_cnt - 1)];
+    if (recv->empty())
+        return NULL;
+
+    uint64_t starttime = get_sys_clock();
+    uint64_t enters = recv->ring.enter_cnt;
+    uint64_t size = 0;
+    UringConn *conn = NULL;
+    char *buf = recv->next_frame(size, conn, URING_WAIT);
+    INC_STATS(thd_id, msg_uring_enter_cnt, recv->ring.enter_cnt - enters);
+    if (buf == NULL)
+    {
+        INC_STATS(thd_id, msg_recv_idle_time, get_sys_clock() - starttime);
+        return NULL;
+    }
+
+    INC_STATS(thd_id, msg_recv_time, get_sys_clock() - starttime);
+    INC_STATS(thd_id, msg_recv_cnt, 1);
+    std::vector<Message *> *msgs = unpack(thd_id, buf, size);
+    recv->consume(conn, size);
+    if (msgs->empty())
+    {
+        delete msgs;
+        return NULL;
+    }
+    DEBUG("Batch of %ld bytes recv from node %ld\n", size, msgs->front()->return_node_id);
+    INC_GLOB_STATS_ARR(bytes_received, msgs->front()->return_node_id, size);
+    return msgs;
+}
+#endif
+
+#if REBALANCE_INPUT
+void Transport::add_sock_load(Socket *sock, uint64_t owner)
+{
+    SockLoad *load = new SockLoad;
+    load->sock = sock;
+    load->owner = owner;
+    load->next_owner = owner;
+    load->busy_time = 0;
+    load->bytes = 0;
+    load->frames = 0;
+    sock_loads.push_back(load);
+}
+
+// Called by an input thread between frames: hands over the sockets moved
+// away from it and picks up the list for the current epoch.
+void Transport::refresh_view(uint64_t input_id)
+{
+    InputView &view = input_views[input_id];
+    uint64_t epoch = assign_epoch.load(std::memory_order_acquire);
+    for (uint64_t i = 0; i < view.socks.size(); i++)
+    {
+        SockLoad *load = sock_loads[view.socks[i]];
+        uint64_t next_owner = load->next_owner.load(std::memory_order_acquire);
+        if (next_owner != input_id && load->owner.load(std::memory_order_relaxed) == input_id)
+            load->owner.store(next_owner, std::memory_order_release);
+    }
+    view.socks.clear();
+    for (uint64_t i = 0; i < sock_loads.size(); i++)
+    {
+        if (sock_loads[i]->next_owner.load(std::memory_order_acquire) == input_id)
+            view.socks.push_back(i);
+    }
+    view.next = 0;
+    view.epoch = epoch;
+}
+
+/*
+    Compares the time each input thread spent on frames over the last period
+    and moves sockets from the busiest thread to the idlest one. A socket only
+    moves if its load is below the gap between the two, so the busiest thread
+    gets lighter and a single heavy socket does not bounce between threads.
+*/
+void Transport::rebalance(uint64_t now)
+{
+    last_rebalance = now;
+    double load[REM_THREAD_CNT] = {0};
+    std::vector<uint64_t> delta(sock_loads.size());
+    for (uint64_t i = 0; i < sock_loads.size(); i++)
+    {
+        SockLoad *sl = sock_loads[i];
+        uint64_t busy = sl->busy_time.load(std::memory_order_relaxed);
+        delta[i] = busy - sl->last_busy;
+        sl->last_busy = busy;
+        load[sl->next_owner.load(std::memory_order_relaxed)] += delta[i];
+    }
+
+    bool moved = false;
+    for (uint64_t m = 0; m < REBALANCE_MOVES; m++)
+    {
+        uint64_t hot = 0;
+        uint64_t cold = 0;
+        for (uint64_t t = 1; t < g_this_rem_thread_cnt; t++)
+        {
+            if (load[t] > load[hot])
+                hot = t;
+            if (load[t] < load[cold])
+                cold = t;
+        }
+        double gap = load[hot] - load[cold];
+        if (gap <= REBALANCE_GAP * load[hot])
+            break;
+
+        // The socket that comes closest to halving the gap.
+        uint64_t best = UINT64_MAX;
+        for (uint64_t i = 0; i < sock_loads.size(); i++)
+        {
+            SockLoad *sl = sock_loads[i];
+            if (sl->next_owner.load(std::memory_order_relaxed) != hot || sl->owner.load(std::memory_order_acquire) != hot)
+                continue;
+            if (delta[i] == 0 || delta[i] >= gap)
+                continue;
+            if (best == UINT64_MAX || fabs(gap / 2 - delta[i]) < fabs(gap / 2 - delta[best]))
+                best = i;
+        }
+        if (best == UINT64_MAX)
+            break;
+        sock_loads[best]->next_owner.store(cold, std::memory_order_release);
+        load[hot] -= delta[best];
+        load[cold] += delta[best];
+        input_sock_moves++;
+        moved = true;
+        printf("Input socket %ld (%ld frames, %ld bytes) moved from thread %ld to %ld\n", best, sock_loads[best]->frames.load(), sock_loads[best]->bytes.load(), hot, cold);
+    }
+    if (moved)
+        assign_epoch.fetch_add(1, std::memory_order_release);
+}
+
+std::vector<Message *> *Transport::recv_balanced(uint64_t thd_id)
+{
+    uint64_t input_id = thd_id % g_this_rem_thread_cnt;
+    InputView &view = input_views[input_id];
+    uint64_t starttime = get_sys_clock();
+
+    // The time since the last frame was handed out went into processing it.
+    if (view.cur != UINT64_MAX)
+    {
+        uint64_t busy = starttime - view.ret_time;
+        sock_loads[view.cur]->busy_time.fetch_add(busy, std::memory_order_relaxed);
+        input_thd_busy_time[input_id] += busy;
+        view.cur = UINT64_MAX;
+    }
+    if (assign_epoch.load(std::memory_order_acquire) != view.epoch)
+        refresh_view(input_id);
+    if (starttime - last_rebalance.load(std::memory_order_relaxed) >= REBALANCE_PERIOD && rebalance_lock.try_lock())
+    {
+        if (starttime - last_rebalance.load(std::memory_order_relaxed) >= REBALANCE_PERIOD)
+            rebalance(starttime);
+        rebalance_lock.unlock();
+    }
+
+    for (uint64_t i = 0; i < view.socks.size(); i++)
+    {
+        uint64_t idx = view.socks[view.next];
+        view.next = (view.next + 1) % view.socks.size();
+        SockLoad *sl = sock_loads[idx];
+        // Not ours until the previous owner has handed it over.
+        if (sl->owner.load(std::memory_order_acquire) != input_id)
+            continue;
+        void *buf = NULL;
+        int bytes = sl->sock->sock.recv(&buf, NNG_FLAG_ALLOC | NNG_FLAG_NONBLOCK);
+        if (bytes <= 0)
+            continue;
+
+        INC_STATS(thd_id, msg_recv_time, get_sys_clock() - starttime);
+        INC_STATS(thd_id, msg_recv_cnt, 1);
+        sl->bytes.fetch_add(bytes, std::memory_order_relaxed);
+        sl->frames.fetch_add(1, std::memory_order_relaxed);
+        std::vector<Message *> *msgs = unpack(thd_id, (char *)buf, bytes);
+        if (msgs->empty())
+        {
+            nn::freemsg(buf, bytes);
+            delete msgs;
+            return NULL;
+        }
+        DEBUG("Batch of %d bytes recv from node %ld\n", bytes, msgs->front()->return_node_id);
+        INC_GLOB_STATS_ARR(bytes_received, msgs->front()->return_node_id, bytes);
+        nn::freemsg(buf, bytes);
+        view.cur = idx;
+        view.ret_time = get_sys_clock();
+        return msgs;
+    }
+    INC_STATS(thd_id, msg_recv_idle_time, get_sys_clock() - starttime);
+    return NULL;
+}
+#endif
+
+// Output threads read PeerLink::failed, so sending takes no lock.
+void Transport::mark_failed_node(uint64_t dest_node_id)
+{
+    cout << "Adding failed node: " << dest_node_id << "\n";
+    if (peers)
+    {
+        for (uint64_t i = 0; i < g_this_send_thread_cnt; i++)
+            peers[i * g_total_node_cnt + dest_node_id].failed = true;
+    }
+#if VIEW_CHANGES || LOCAL_FAULT || PVP_RECOVERY
     if (ISSERVER)
     {
         stop_lock.lock();
-        if(stop_node_set.count(dest_node_id)){
-            failednode = true;
-        }        
+        stop_node_set.insert(dest_node_id);
         stop_lock.unlock();
     }
     else
     {
         clistopMTX.lock();
-        for (uint i = 0; i < stop_replicas.size(); i++)
+        stop_replicas.push_back(dest_node_id);
+        clistopMTX.unlock();
+    }
+#endif
+}
+
+// Retries a frame until the peer takes it. Returns false, after releasing the
+// frame, if the peer is given up on.
+bool Transport::send_blocking(PeerLink *peer, uint64_t dest_node_id, uint64_t send_thread_id, nng_msg *nmsg)
+{
+    int rc = -1;
+#if LINK_STATS
+    // Only the time after a first failed attempt counts as blocked.
+    rc = peer->sock->sock.sendmsg(nmsg, NNG_FLAG_NONBLOCK);
+    if (rc >= 0)
+        return true;
+    uint64_t blocked = get_sys_clock();
+#endif
+#if VIEW_CHANGES || LOCAL_FAULT || PVP_RECOVERY
+    uint64_t time = get_sys_clock();
+    while ((rc < 0 && (get_sys_clock() - time < MSG_TIMEOUT || !simulation->is_setup_done())) && (!simulation->is_setup_done() || !simulation->is_done()))
+    {
+        rc = peer->sock->sock.sendmsg(nmsg, NNG_FLAG_NONBLOCK);
+    }
+    INC_LINK_STATS(send_thread_id, dest_node_id, send_blocked_time, get_sys_clock() - blocked);
+    if (rc < 0)
+    {
+        nng_msg_free(nmsg);
+        mark_failed_node(dest_node_id);
+        return false;
+    }
+#else
+    while (rc < 0 && (!simulation->is_setup_done() || !simulation->is_done()))
+    {
+        rc = peer->sock->sock.sendmsg(nmsg, NNG_FLAG_NONBLOCK);
+    }
+    INC_LINK_STATS(send_thread_id, dest_node_id, send_blocked_time, get_sys_clock() - blocked);
+    if (rc < 0)
+    {
+        nng_msg_free(nmsg);
+        return false;
+    }
+#endif
+    return true;
+}
+
+#if SEND_BACKPRESSURE || QUORUM_START
+void Transport::park_frame(PeerLink *peer, uint64_t dest_node_id, uint64_t send_thread_id, nng_msg *nmsg)
+{
+    if (peer->parked.empty())
+        parked_peers[get_peer_index(dest_node_id, send_thread_id) / g_total_node_cnt]++;
+    peer->parked.push_back(nmsg);
+    INC_STATS(send_thread_id, msg_send_parked_cnt, 1);
+}
+
+// Hands parked frames of a peer to its socket in order, stopping at the first
+// frame the peer cannot take yet.
+void Transport::flush_parked(PeerLink *peer, uint64_t dest_node_id, uint64_t send_thread_id)
+{
+    while (!peer->parked.empty())
+    {
+        if (peer->sock->sock.sendmsg(peer->parked.front(), NNG_FLAG_NONBLOCK) < 0)
+            return;
+        peer->parked.pop_front();
+    }
+    parked_peers[get_peer_index(dest_node_id, send_thread_id) / g_total_node_cnt]--;
+}
+
+void Transport::drop_parked(PeerLink *peer, uint64_t dest_node_id, uint64_t send_thread_id)
+{
+    if (peer->parked.empty())
+        return;
+    while (!peer->parked.empty())
+    {
+        nng_msg_free(peer->parked.front());
+        peer->parked.pop_front();
+        INC_STATS(send_thread_id, msg_send_dropped_cnt, 1);
+    }
+    parked_peers[get_peer_index(dest_node_id, send_thread_id) / g_total_node_cnt]--;
+}
+
+/*
+    A peer whose frames cannot be held any longer is treated as failed by
+    every output thread. Dropping only some of its frames would let it vote
+    later with holes in its instances, which nothing fills in.
+*/
+void Transport::give_up_peer(PeerLink *peer, uint64_t dest_node_id, uint64_t send_thread_id)
+{
+    drop_parked(peer, dest_node_id, send_thread_id);
+    mark_failed_node(dest_node_id);
+}
+
+void Transport::retry_parked(uint64_t send_thread_id)
+{
+    uint64_t base = get_peer_index(0, send_thread_id);
+    if (parked_peers[base / g_total_node_cnt] == 0)
+        return;
+    for (uint64_t dest_node_id = 0; dest_node_id < g_total_node_cnt; dest_node_id++)
+    {
+        PeerLink *peer = &peers[base + dest_node_id];
+        if (peer->failed)
         {
-            if (dest_node_id == stop_replicas[i])
-            {
-                failednode = true;
-                break;
-            }
+            drop_parked(peer, dest_node_id, send_thread_id);
+            continue;
         }
-        clistopMTX.unlock();
+#if QUORUM_START
+        if (!peer->ready.load(std::memory_order_acquire))
+            continue;
+#endif
+        if (!peer->parked.empty())
+            flush_parked(peer, dest_node_id, send_thread_id);
     }
-    if (!failednode)
+}
+
+bool Transport::has_parked(uint64_t send_thread_id)
+{
+    return parked_peers[get_peer_index(0, send_thread_id) / g_total_node_cnt] > 0;
+}
+#endif
+
+// Gathers the pieces of a frame straight into the nng message handed to the
+// socket, so callers need not flatten them into an mbuf first.
+void Transport::send_msg_iov(uint64_t send_thread_id, uint64_t dest_node_id, const nng_iov *iov, uint64_t iov_cnt)
+{
+    uint64_t starttime = get_sys_clock();
+
+    uint64_t peer_idx = get_peer_index(dest_node_id, send_thread_id);
+    PeerLink *peer = &peers[peer_idx];
+    uint64_t size = 0;
+    for (uint64_t i = 0; i < iov_cnt; i++)
+        size += iov[i].iov_len;
+#if RECORD_REPLAY
+    if (replaying)
     {
-        int rc = -1;
-        uint64_t time = get_sys_clock();
-        while ((rc < 0 && (get_sys_clock() - time < MSG_TIMEOUT || !simulation->is_setup_done())) && (!simulation->is_setup_done() || !simulation->is_done()))
+        INC_GLOB_STATS_ARR(bytes_sent, dest_node_id, size);
+        INC_STATS(send_thread_id, msg_send_cnt, 1);
+        return;
+    }
+#endif
+#if WIRE_COMPRESS
+    nng_iov packed_iov;
+    if (size >= COMPRESS_MIN_SIZE)
+    {
+        char *frame;
+        uint64_t packed_size = compress_frame(send_thread_id, peer_idx / g_total_node_cnt, iov, iov_cnt, size, frame);
+        if (packed_size > 0)
         {
-            rc = socket->sock.send(sbuf, size, NNG_FLAG_NONBLOCK);
+            packed_iov.iov_buf = frame;
+            packed_iov.iov_len = packed_size;
+            iov = &packed_iov;
+            iov_cnt = 1;
+            size = packed_size;
         }
-        if (rc < 0)
+    }
+#endif
+#if LINK_STATS
+    assert(iov[0].iov_len >= 3 * sizeof(uint32_t));
+    uint32_t msg_cnt = ((uint32_t *)iov[0].iov_buf)[2] & ~(VOTE_BUNDLE_FLAG | COMPRESS_FLAG);
+    LinkStamp stamp;
+    stamp.ts = starttime;
+    stamp.echo = 0;
+    stamp.hold = 0;
+    LinkEcho &echo = link_echo[dest_node_id];
+    echo.lock.lock();
+    if (echo.ts != 0)
+    {
+        stamp.echo = echo.ts;
+        stamp.hold = starttime > echo.recv_at ? starttime - echo.recv_at : 0;
+        echo.ts = 0;
+    }
+    echo.lock.unlock();
+    nng_iov stamped_iov[LINK_IOV_MAX];
+    assert(iov_cnt < LINK_IOV_MAX);
+    memcpy(stamped_iov, iov, sizeof(nng_iov) * iov_cnt);
+    stamped_iov[iov_cnt].iov_buf = &stamp;
+    stamped_iov[iov_cnt].iov_len = sizeof(stamp);
+    iov = stamped_iov;
+    iov_cnt++;
+    size += sizeof(stamp);
+
+    uint64_t sendq_len = peer->parked.size();
+#if IO_URING_TRANSPORT
+    sendq_len += peer->sendq.size();
+#endif
+    INC_LINK_STATS(send_thread_id, dest_node_id, bytes_sent, size);
+    INC_LINK_STATS(send_thread_id, dest_node_id, frames_sent, 1);
+    INC_LINK_STATS(send_thread_id, dest_node_id, msgs_sent, msg_cnt);
+    INC_LINK_STATS(send_thread_id, dest_node_id, sendq_sum, sendq_len);
+    if (STATS_ENABLE && simulation->is_warmup_done())
+        stats._stats[send_thread_id]->links[dest_node_id].sendq_max = max(stats._stats[send_thread_id]->links[dest_node_id].sendq_max, sendq_len);
+#endif
+#if SHM_TRANSPORT
+    if (peer->ring)
+    {
+        send_ring(peer, send_thread_id, dest_node_id, iov, iov_cnt, size);
+        return;
+    }
+#endif
+#if IO_URING_TRANSPORT
+    send_uring(peer, send_thread_id, dest_node_id, iov, iov_cnt, size);
+    return;
+#endif
+    INC_GLOB_STATS_ARR(bytes_sent, dest_node_id, size);
+    if (peer->failed)
+        return;
+    nng_msg *nmsg;
+    int arc = nng_msg_alloc(&nmsg, size);
+    assert(arc == 0);
+    char *body = (char *)nng_msg_body(nmsg);
+    for (uint64_t i = 0; i < iov_cnt; i++)
+    {
+        memcpy(body, iov[i].iov_buf, iov[i].iov_len);
+        body += iov[i].iov_len;
+    }
+    DEBUG("%ld Sending batch of %ld bytes to node %ld on socket %ld\n", send_thread_id, size, dest_node_id, (uint64_t)peer->sock);
+
+#if QUORUM_START
+    // Frames for a peer still connecting wait for its pipe, so that one slow
+    // host does not hold up the other destinations. A peer that does not
+    // connect in time is given up on.
+    if (!peer->ready.load(std::memory_order_acquire))
+    {
+        if (peer->parked.size() >= QUORUM_PARK_LEN)
         {
-            cout << "Adding failed node: " << dest_node_id << "\n";
-            if (ISSERVER)
-            {
-                stop_lock.lock();
-                stop_node_set.insert(dest_node_id);
-                stop_lock.unlock();
-            }
-            else
-            {
-                clistopMTX.lock();
-                stop_replicas.push_back(dest_node_id);
-                clistopMTX.unlock();
-            }
+            give_up_peer(peer, dest_node_id, send_thread_id);
+            nng_msg_free(nmsg);
+            INC_STATS(send_thread_id, msg_send_dropped_cnt, 1);
+            return;
         }
+        park_frame(peer, dest_node_id, send_thread_id, nmsg);
+        return;
     }
+#endif
+#if SEND_BACKPRESSURE || QUORUM_START
+    // Parked frames go out first. While some remain, a new frame queues
+    // behind them so that the other destinations of this output thread are
+    // not held up; a peer whose queue is full is given up on.
+    if (!peer->parked.empty())
+        flush_parked(peer, dest_node_id, send_thread_id);
+#if SEND_BACKPRESSURE
+    if (!peer->parked.empty() || peer->sock->sock.sendmsg(nmsg, NNG_FLAG_NONBLOCK) < 0)
 #else
-    int rc = -1;
-    while (rc < 0 && (!simulation->is_setup_done() || !simulation->is_done()))
+    if (!peer->parked.empty())
+#endif
     {
-        rc = socket->sock.send(sbuf, size, NNG_FLAG_NONBLOCK);
+        if (peer->parked.size() >= (SEND_BACKPRESSURE ? PEER_SENDQ_LEN : QUORUM_PARK_LEN))
+        {
+            give_up_peer(peer, dest_node_id, send_thread_id);
+            nng_msg_free(nmsg);
+            INC_STATS(send_thread_id, msg_send_dropped_cnt, 1);
+            return;
+        }
+        park_frame(peer, dest_node_id, send_thread_id, nmsg);
+    }
+#if !SEND_BACKPRESSURE
+    else
+    {
+        send_blocking(peer, dest_node_id, send_thread_id, nmsg);
     }
 #endif
+#else
+    send_blocking(peer, dest_node_id, send_thread_id, nmsg);
+#endif
 
-    //nn_freemsg(sbuf);
-    DEBUG("%ld Batch of %d bytes sent to node %ld\n", send_thread_id, size, dest_node_id);
+    DEBUG("%ld Batch of %ld bytes sent to node %ld\n", send_thread_id, size, dest_node_id);
 
     INC_STATS(send_thread_id, msg_send_time, get_sys_clock() - starttime);
     INC_STATS(send_thread_id, msg_send_cnt, 1);
 }
 
+// Parses the messages of a received frame. With LINK_STATS, first strips the
+// stamp and accounts the frame to its link. A frame that cannot be decoded
+// gives an empty vector.
+std::vector<Message *> *Transport::unpack(uint64_t thd_id, char *buf, uint64_t size)
+{
+#if RECORD_REPLAY
+    if (recording)
+        record_frame(thd_id, buf, size);
+#endif
+#if LINK_STATS
+    uint64_t now = get_sys_clock();
+    LinkStamp stamp;
+    assert(size >= 3 * sizeof(uint32_t) + sizeof(stamp));
+    size -= sizeof(stamp);
+    memcpy(&stamp, buf + size, sizeof(stamp));
+    uint64_t src = ((uint32_t *)buf)[1];
+    uint32_t msg_cnt = ((uint32_t *)buf)[2] & ~(VOTE_BUNDLE_FLAG | COMPRESS_FLAG);
+
+    INC_LINK_STATS(thd_id, src, bytes_recv, size + sizeof(stamp));
+    INC_LINK_STATS(thd_id, src, frames_recv, 1);
+    INC_LINK_STATS(thd_id, src, msgs_recv, msg_cnt);
+    if (stamp.echo != 0 && now > stamp.echo + stamp.hold && STATS_ENABLE && simulation->is_warmup_done())
+    {
+        LinkStats &link = stats._stats[thd_id]->links[src];
+        uint64_t rtt = now - stamp.echo - stamp.hold;
+        link.rtt_sum += rtt;
+        link.rtt_cnt++;
+        link.rtt_min = min(link.rtt_min, rtt);
+    }
+    LinkEcho &echo = link_echo[src];
+    echo.lock.lock();
+    echo.ts = stamp.ts;
+    echo.recv_at = now;
+    echo.lock.unlock();
+#endif
+#if WIRE_COMPRESS
+    uint32_t *head = (uint32_t *)buf;
+    if (head[2] & COMPRESS_FLAG)
+    {
+        uint64_t starttime = get_sys_clock();
+        uint64_t packed_off = 4 * sizeof(uint32_t);
+        uint32_t body_size = 0;
+        if (size >= packed_off)
+            memcpy(&body_size, buf + 3 * sizeof(uint32_t), sizeof(body_size));
+        if (size < packed_off || body_size == 0 || body_size > COMPRESS_MAX_FRAME)
+        {
+            assert(0);
+            return new std::vector<Message *>;
+        }
+        uint64_t raw_size = 3 * sizeof(uint32_t) + body_size;
+        char *raw = (char *)mem_allocator.alloc(raw_size);
+        uint32_t *raw_head = (uint32_t *)raw;
+        raw_head[0] = head[0];
+        raw_head[1] = head[1];
+        raw_head[2] = head[2] & ~COMPRESS_FLAG;
+        if (!lz_decompress(buf + packed_off, size - packed_off, raw + 3 * sizeof(uint32_t), body_size))
+        {
+            assert(0);
+            mem_allocator.free(raw, raw_size);
+            return new std::vector<Message *>;
+        }
+        INC_STATS(thd_id, msg_decompress_time, get_sys_clock() - starttime);
+        std::vector<Message *> *msgs = Message::create_messages(raw, raw_size);
+        mem_allocator.free(raw, raw_size);
+        return msgs;
+    }
+#endif
+    return Message::create_messages(buf, size);
+}
+
+#if WIRE_COMPRESS
+// Packs a frame as [header | COMPRESS_FLAG][uint32 body size][compressed body]
+// in the scratch space of the output thread. Returns the packed size, or 0 if
+// the frame should go out as is.
+uint64_t Transport::compress_frame(uint64_t send_thread_id, uint64_t rel_thd, const nng_iov *iov, uint64_t iov_cnt, uint64_t size, char *&frame)
+{
+    uint64_t starttime = get_sys_clock();
+    uint64_t head_size = 3 * sizeof(uint32_t);
+    std::vector<char> &buf = pack_bufs[rel_thd];
+    if (buf.size() < 2 * size)
+        buf.resize(2 * size);
+    char *raw = buf.data();
+    char *ptr = raw;
+    for (uint64_t i = 0; i < iov_cnt; i++)
+    {
+        memcpy(ptr, iov[i].iov_buf, iov[i].iov_len);
+        ptr += iov[i].iov_len;
+    }
+    assert(size > head_size);
+    frame = raw + size;
+    uint64_t packed_off = head_size + sizeof(uint32_t);
+    // Only worth it if the packed frame comes out smaller.
+    uint64_t packed = lz_compress(raw + head_size, size - head_size, frame + packed_off, size - packed_off);
+    INC_STATS(send_thread_id, msg_compress_time, get_sys_clock() - starttime);
+    if (packed == 0)
+    {
+        INC_STATS(send_thread_id, msg_compress_skip_cnt, 1);
+        return 0;
+    }
+    uint32_t *head = (uint32_t *)frame;
+    memcpy(head, raw, head_size);
+    head[2] |= COMPRESS_FLAG;
+    uint32_t body_size = size - head_size;
+    memcpy(frame + head_size, &body_size, sizeof(body_size));
+    INC_STATS(send_thread_id, msg_compress_cnt, 1);
+    INC_STATS(send_thread_id, msg_compress_raw_bytes, size);
+    INC_STATS(send_thread_id, msg_compress_wire_bytes, packed_off + packed);
+    return packed_off + packed;
+}
+#endif
+
+#if RECORD_REPLAY
+void Transport::open_frame_logs()
+{
+    const char *record_dir = getenv("RDB_RECORD_DIR");
+    const char *replay_dir = getenv("RDB_REPLAY_DIR");
+    if (record_dir == NULL && replay_dir == NULL)
+        return;
+    replaying = replay_dir != NULL;
+    recording = !replaying;
+    replay_paced = getenv("RDB_REPLAY_PACED") != NULL;
+    frame_logs = new FrameLog[g_this_rem_thread_cnt];
+    for (uint64_t i = 0; i < g_this_rem_thread_cnt; i++)
+    {
+        char name[MAX_TPORT_NAME * 4];
+        snprintf(name, sizeof(name), "%s/frames_%d_%ld.log", replaying ? replay_dir : record_dir, g_node_id, i);
+        frame_logs[i].file = fopen(name, replaying ? "rb" : "wb");
+        if (frame_logs[i].file == NULL)
+        {
+            printf("Cannot open frame log %s\n", name);
+            assert(false);
+        }
+        setvbuf(frame_logs[i].file, NULL, _IOFBF, 1 << 20);
+    }
+    printf("%s frames %s\n", replaying ? "Replaying" : "Recording", replaying ? replay_dir : record_dir);
+    log_start = get_sys_clock();
+}
+
+void Transport::record_frame(uint64_t thd_id, const char *buf, uint64_t size)
+{
+    FrameLog &log = frame_logs[thd_id % g_this_rem_thread_cnt];
+    uint64_t at = get_sys_clock() - log_start;
+    uint32_t frame_size = size;
+    fwrite(&at, sizeof(at), 1, log.file);
+    fwrite(&frame_size, sizeof(frame_size), 1, log.file);
+    fwrite(buf, 1, size, log.file);
+}
+
+// Next logged frame of the input thread; with pacing, not before the time it
+// arrived at in the recorded run.
+std::vector<Message *> *Transport::replay_frame(uint64_t thd_id)
+{
+    uint64_t starttime = get_sys_clock();
+    FrameLog &log = frame_logs[thd_id % g_this_rem_thread_cnt];
+    if (!log.has_next)
+    {
+        if (fread(&log.next_at, sizeof(log.next_at), 1, log.file) != 1 ||
+            fread(&log.next_size, sizeof(log.next_size), 1, log.file) != 1)
+        {
+            INC_STATS(thd_id, msg_recv_idle_time, get_sys_clock() - starttime);
+            return NULL;
+        }
+        log.has_next = true;
+    }
+    if (replay_paced && starttime - log_start < log.next_at)
+    {
+        INC_STATS(thd_id, msg_recv_idle_time, get_sys_clock() - starttime);
+        return NULL;
+    }
+    log.buf.resize(log.next_size);
+    if (fread(log.buf.data(), 1, log.next_size, log.file) != log.next_size)
+        assert(false);
+    log.has_next = false;
+    INC_STATS(thd_id, msg_recv_time, get_sys_clock() - starttime);
+    INC_STATS(thd_id, msg_recv_cnt, 1);
+    std::vector<Message *> *msgs = unpack(thd_id, log.buf.data(), log.next_size);
+    if (msgs->empty())
+    {
+        delete msgs;
+        return NULL;
+    }
+    INC_GLOB_STATS_ARR(bytes_received, msgs->front()->return_node_id, log.next_size);
+    return msgs;
+}
+#endif
+
 // Listens to sockets for messages from other nodes
 std::vector<Message *> *Transport::recv_msg(uint64_t thd_id)
 {
@@ -381,9 +1440,28 @@ std::vector<Message *> *Transport::recv_msg(uint64_t thd_id)
     std::vector<Message *> *msgs = NULL;
 
     uint64_t ctr, start_ctr;
+#if RECORD_REPLAY
+    if (replaying)
+        return replay_frame(thd_id);
+#endif
+#if SHM_TRANSPORT
+    msgs = recv_ring(thd_id);
+    if (msgs)
+        return msgs;
+#endif
+#if IO_URING_TRANSPORT
+    return recv_uring(thd_id);
+#endif
+#if REBALANCE_INPUT
+    if (ISSERVER)
+        return recv_balanced(thd_id);
+#endif
     uint64_t starttime = get_sys_clock();
     if (!ISSERVER)
     {
+        // No sockets when every peer is reached over shared memory.
+        if (recv_sockets.empty())
+            return msgs;
         uint64_t rand = (starttime % recv_sockets.size()) / g_this_rem_thread_cnt;
         ctr = thd_id % g_this_rem_thread_cnt;
 
@@ -404,12 +1482,14 @@ std::vector<Message *> *Transport::recv_msg(uint64_t thd_id)
         // One thread manages client sockets, while others handles server sockets.
         if (thd_id % g_this_rem_thread_cnt == 0)
         {
+            if (recv_sockets_clients.empty())
+                return msgs;
             ctr = get_next_socket(thd_id, recv_sockets_clients.size());
         }
         else
         {
             uint64_t abs_tid = thd_id % (g_rem_thread_cnt - 1);
-            #if FIX_INPUT_THREAD_BUG
+            #if FIX_INPUT_THREAD_BUG || SHM_TRANSPORT
             if(!recv_sockets_servers[abs_tid].size())
                 return msgs;
             #endif
@@ -498,7 +1578,13 @@ std::vector<Message *> *Transport::recv_msg(uint64_t thd_id)
     INC_STATS(thd_id, msg_recv_cnt, 1);
 
     starttime = get_sys_clock();
-    msgs = Message::create_messages((char *)buf);
+    msgs = unpack(thd_id, (char *)buf, bytes);
+    if (msgs->empty())
+    {
+        nn::freemsg(buf, bytes);
+        delete msgs;
+        return NULL;
+    }
     DEBUG("Batch of %d bytes recv from node %ld; Time: %f\n", bytes, msgs->front()->return_node_id, simulation->seconds_from_start(get_sys_clock()));
     INC_GLOB_STATS_ARR(bytes_received, msgs->front()->return_node_id, bytes);
     nn::freemsg(buf, bytes);
@@ -3,6 +3,11 @@
 #include "global.h"
 #include "nn.hpp"
 #include "query.h"
+#include "shm_ring.h"
+#include "uring.h"
+#include "compress.h"
+#include <atomic>
+#include <deque>
 
 class Workload;
 class Message;
@@ -20,6 +25,31 @@ public:
 	char _pad[CL_SIZE - sizeof(nn::socket)];
 };
 
+// Send state of one destination for one output thread.
+struct PeerLink
+{
+	Socket *sock = NULL;
+	// Frames the peer could not take yet, oldest first.
+	std::deque<nng_msg *> parked;
+	// Set for every output thread at once, so a peer misses all frames from
+	// then on rather than some of them.
+	std::atomic<bool> failed{false};
+#if QUORUM_START
+	// Set by nng once the dialer has a pipe to the peer.
+	std::atomic<bool> ready{false};
+#endif
+#if SHM_TRANSPORT
+	// Set instead of sock for peers on the same host.
+	ShmRing *ring = NULL;
+#endif
+#if IO_URING_TRANSPORT
+	int fd = -1;
+	// Frames as [uint32 len][frame]; the front one is being written.
+	std::deque<std::pair<char *, uint64_t>> sendq;
+	uint64_t sent = 0; // bytes of the front frame written so far
+#endif
+};
+
 class Transport
 {
 public:
@@ -33,15 +63,143 @@ public:
 	uint64_t get_port_id(uint64_t src_node_id, uint64_t dest_node_id);
 	uint64_t get_port_id(uint64_t src_node_id, uint64_t dest_node_id, uint64_t send_thread_id);
 	Socket *bind(uint64_t port_id);
-	Socket *connect(uint64_t dest_id, uint64_t port_id);
+	Socket *connect(uint64_t dest_id, uint64_t port_id, PeerLink *peer = NULL);
 	void send_msg(uint64_t send_thread_id, uint64_t dest_node_id, void *sbuf, int size);
+	void send_msg_iov(uint64_t send_thread_id, uint64_t dest_node_id, const nng_iov *iov, uint64_t iov_cnt);
 	std::vector<Message *> *recv_msg(uint64_t thd_id);
+#if SEND_BACKPRESSURE || QUORUM_START
+	void retry_parked(uint64_t send_thread_id);
+	bool has_parked(uint64_t send_thread_id);
+#endif
+#if IO_URING_TRANSPORT
+	void flush_sends(uint64_t send_thread_id);
+	bool has_inflight(uint64_t send_thread_id);
+#endif
 	void simple_send_msg(int size);
 	uint64_t simple_recv_msg();
+	void mark_failed_node(uint64_t dest_node_id);
 
 private:
 	uint64_t rr;
-	std::map<std::pair<uint64_t, uint64_t>, Socket *> send_sockets; // dest_node_id,send_thread_id : socket
+	uint64_t get_peer_index(uint64_t dest_node_id, uint64_t send_thread_id);
+	bool send_blocking(PeerLink *peer, uint64_t dest_node_id, uint64_t send_thread_id, nng_msg *nmsg);
+	PeerLink *peers = NULL; // [send_thread_id][dest_node_id]
+#if LINK_STATS
+	// Trailer of every frame. A node echoes the latest stamp it got from the
+	// peer, with the time it held it, so the sender of the stamp gets an RTT
+	// on its own clock.
+	struct LinkStamp
+	{
+		uint64_t ts;
+		uint64_t echo;
+		uint64_t hold;
+	};
+	// Latest stamp from a peer not yet echoed back.
+	struct LinkEcho
+	{
+		std::mutex lock;
+		uint64_t ts = 0;
+		uint64_t recv_at = 0;
+	};
+	LinkEcho *link_echo = NULL; // [node_id]
+#endif
+	std::vector<Message *> *unpack(uint64_t thd_id, char *buf, uint64_t size);
+#if RECORD_REPLAY
+	// Frames of one input thread, stored as [uint64 arrival][uint32 size][frame]
+	// with the arrival in ns since init.
+	struct FrameLog
+	{
+		FILE *file = NULL;
+		std::vector<char> buf;
+		uint64_t next_at = 0;
+		uint32_t next_size = 0;
+		bool has_next = false;
+	};
+	void open_frame_logs();
+	void record_frame(uint64_t thd_id, const char *buf, uint64_t size);
+	std::vector<Message *> *replay_frame(uint64_t thd_id);
+	FrameLog *frame_logs = NULL;
+	bool recording = false;
+	bool replaying = false;
+	bool replay_paced = false;
+	uint64_t log_start = 0;
+#endif
+#if WIRE_COMPRESS
+	uint64_t compress_frame(uint64_t send_thread_id, uint64_t rel_thd, const nng_iov *iov, uint64_t iov_cnt, uint64_t size, char *&frame);
+	std::vector<char> *pack_bufs = NULL; // Scratch space per output thread
+#endif
+#if SHM_TRANSPORT
+	bool is_colocated(uint64_t node_id);
+	string get_ring_name(uint64_t src_node_id, uint64_t dest_node_id, uint64_t send_thread_id);
+	void send_ring(PeerLink *peer, uint64_t send_thread_id, uint64_t dest_node_id, const nng_iov *iov, uint64_t iov_cnt, uint64_t size);
+	std::vector<Message *> *recv_ring(uint64_t thd_id);
+	// Rings read by the input threads, split like the sockets below.
+	std::vector<ShmRing *> recv_rings;
+	std::vector<ShmRing *> recv_rings_clients;
+	std::vector<ShmRing *> recv_rings_servers[REM_THREAD_CNT - 1];
+#endif
+#if IO_URING_TRANSPORT
+	struct UringDial
+	{
+		uint64_t peer_idx;
+		uint64_t node_id;
+		uint64_t port_id;
+	};
+	UringReceiver *get_receiver(uint64_t node_id);
+	void send_uring(PeerLink *peer, uint64_t send_thread_id, uint64_t dest_node_id, const nng_iov *iov, uint64_t iov_cnt, uint64_t size);
+	void submit_send(URing *ring, PeerLink *peer, uint64_t peer_idx);
+	void reap_sends(uint64_t send_thread_id);
+	void drop_sends(PeerLink *peer, uint64_t rel_thd);
+	std::vector<Message *> *recv_uring(uint64_t thd_id);
+	URing *send_rings; // One per output thread
+	uint64_t *inflight_peers; // Peers with frames in flight, per output thread
+	std::vector<UringDial> uring_dials;
+	// Receivers of the input threads, split like the sockets below.
+	std::vector<UringReceiver *> uring_recvs;
+	UringReceiver *uring_recv_clients = NULL;
+	UringReceiver *uring_recv_servers[REM_THREAD_CNT - 1] = {NULL};
+	uint64_t uring_recv_cnt = 0;
+#endif
+#if REBALANCE_INPUT
+	// A receive socket of a replica and the load read from it.
+	struct SockLoad
+	{
+		Socket *sock;
+		// A socket moves when its owner sees next_owner changed and hands it over.
+		std::atomic<uint64_t> owner;
+		std::atomic<uint64_t> next_owner;
+		std::atomic<uint64_t> busy_time; // Time spent on frames read from it
+		std::atomic<uint64_t> bytes;
+		std::atomic<uint64_t> frames;
+		uint64_t last_busy = 0;
+	};
+	// Sockets an input thread reads as of an assignment epoch.
+	struct alignas(CL_SIZE) InputView
+	{
+		uint64_t epoch = 0;
+		std::vector<uint64_t> socks;
+		uint64_t next = 0;
+		uint64_t cur = UINT64_MAX; // Socket of the frame being processed
+		uint64_t ret_time = 0;
+	};
+	void add_sock_load(Socket *sock, uint64_t owner);
+	void refresh_view(uint64_t input_id);
+	void rebalance(uint64_t now);
+	std::vector<Message *> *recv_balanced(uint64_t thd_id);
+	std::vector<SockLoad *> sock_loads;
+	InputView input_views[REM_THREAD_CNT];
+	std::atomic<uint64_t> assign_epoch{0};
+	std::atomic<uint64_t> last_rebalance{0};
+	std::mutex rebalance_lock;
+#endif
+#if SEND_BACKPRESSURE || QUORUM_START
+	void park_frame(PeerLink *peer, uint64_t dest_node_id, uint64_t send_thread_id, nng_msg *nmsg);
+	void flush_parked(PeerLink *peer, uint64_t dest_node_id, uint64_t send_thread_id);
+	void drop_parked(PeerLink *peer, uint64_t dest_node_id, uint64_t send_thread_id);
+	void give_up_peer(PeerLink *peer, uint64_t dest_node_id, uint64_t send_thread_id);
+	// Number of peers with parked frames, per output thread.
+	uint64_t *parked_peers;
+#endif
 
 	// To be used by clients.
 	std::vector<Socket *> recv_sockets;
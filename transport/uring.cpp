@@ -0,0 +1,390 @@
+#include "uring.h"
+#include "mem_alloc.h"
+
+#if IO_URING_TRANSPORT
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define URING_BGID 0
+#define URING_PROVIDE_TAG UINT64_MAX
+
+bool URing::init(unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0)
+    {
+        printf("io_uring_setup Error: %d %s\n", errno, strerror(errno));
+        return false;
+    }
+
+    sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+        sq_len = cq_len = max(sq_len, cq_len);
+    sq_ptr = mmap(NULL, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED)
+    {
+        sq_ptr = NULL;
+        close();
+        return false;
+    }
+    if (single)
+    {
+        cq_ptr = sq_ptr;
+    }
+    else
+    {
+        cq_ptr = mmap(NULL, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq_ptr == MAP_FAILED)
+        {
+            cq_ptr = NULL;
+            close();
+            return false;
+        }
+    }
+    sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = (struct io_uring_sqe *)mmap(NULL, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        sqes = NULL;
+        close();
+        return false;
+    }
+
+    char *sq = (char *)sq_ptr;
+    char *cq = (char *)cq_ptr;
+    sq_head = (unsigned *)(sq + p.sq_off.head);
+    sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    sq_array = (unsigned *)(sq + p.sq_off.array);
+    sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    sq_entries = p.sq_entries;
+    cq_head = (unsigned *)(cq + p.cq_off.head);
+    cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    sqe_tail = *sq_tail;
+    return true;
+}
+
+void URing::close()
+{
+    if (sqes)
+        munmap(sqes, sqes_len);
+    if (cq_ptr && cq_ptr != sq_ptr)
+        munmap(cq_ptr, cq_len);
+    if (sq_ptr)
+        munmap(sq_ptr, sq_len);
+    if (fd >= 0)
+        ::close(fd);
+    sqes = NULL;
+    sq_ptr = cq_ptr = NULL;
+    fd = -1;
+}
+
+struct io_uring_sqe *URing::get_sqe()
+{
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (sqe_tail - head >= sq_entries)
+        return NULL;
+    unsigned idx = sqe_tail & sq_mask;
+    struct io_uring_sqe *sqe = &sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[idx] = idx;
+    sqe_tail++;
+    to_submit++;
+    return sqe;
+}
+
+int URing::submit(unsigned wait_nr, uint64_t timeout)
+{
+    if (to_submit == 0 && wait_nr == 0)
+        return 0;
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+    enter_cnt++;
+    if (wait_nr > 0 && timeout > 0)
+    {
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeout / BILLION;
+        ts.tv_nsec = timeout % BILLION;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)&ts;
+        ret = syscall(__NR_io_uring_enter, fd, to_submit, wait_nr, flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+    else
+    {
+        ret = syscall(__NR_io_uring_enter, fd, to_submit, wait_nr, flags, NULL, 0);
+    }
+    if (ret < 0)
+        return -errno;
+    to_submit -= min((unsigned)ret, to_submit);
+    return ret;
+}
+
+struct io_uring_cqe *URing::peek_cqe()
+{
+    unsigned head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+        return NULL;
+    return &cqes[head & cq_mask];
+}
+
+void URing::cqe_seen()
+{
+    __atomic_store_n(cq_head, *cq_head + 1, __ATOMIC_RELEASE);
+}
+
+static void set_nodelay(int fd)
+{
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+static void fill_addr(struct sockaddr_in *sa, const char *addr, uint64_t port_id)
+{
+    memset(sa, 0, sizeof(*sa));
+    sa->sin_family = AF_INET;
+    sa->sin_port = htons(port_id);
+    if (inet_pton(AF_INET, addr, &sa->sin_addr) != 1)
+    {
+        printf("Bad address: %s\n", addr);
+        assert(false);
+    }
+}
+
+int uring_listen(const char *addr, uint64_t port_id)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in sa;
+    fill_addr(&sa, addr, port_id);
+    printf("Uring Binding to %s:%ld %d\n", addr, port_id, g_node_id);
+    if (::bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 1) < 0)
+    {
+        printf("Bind Error: %d %s\n", errno, strerror(errno));
+        assert(false);
+    }
+    return fd;
+}
+
+// Retries until the peer listens, as nng does for its dialers.
+int uring_connect(const char *src_addr, const char *dest_addr, uint64_t port_id)
+{
+    struct sockaddr_in src;
+    struct sockaddr_in dest;
+    fill_addr(&src, src_addr, 0);
+    fill_addr(&dest, dest_addr, port_id);
+    printf("Uring Connecting to %s:%ld %d\n", dest_addr, port_id, g_node_id);
+    while (true)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        assert(fd >= 0);
+        if (::bind(fd, (struct sockaddr *)&src, sizeof(src)) < 0)
+        {
+            printf("Bind Error: %d %s\n", errno, strerror(errno));
+            assert(false);
+        }
+        if (::connect(fd, (struct sockaddr *)&dest, sizeof(dest)) == 0)
+        {
+            set_nodelay(fd);
+            return fd;
+        }
+        ::close(fd);
+        usleep(10000);
+    }
+}
+
+UringReceiver::~UringReceiver()
+{
+    ring.close();
+    for (uint64_t i = 0; i < listen_fds.size(); i++)
+        close(listen_fds[i]);
+    for (uint64_t i = 0; i < conns.size(); i++)
+    {
+        close(conns[i]->fd);
+        delete conns[i];
+    }
+    if (bufs)
+        mem_allocator.free(bufs, URING_RECV_BUF * URING_RECV_BUF_CNT);
+}
+
+void UringReceiver::accept_all()
+{
+    for (uint64_t i = 0; i < listen_fds.size(); i++)
+    {
+        int fd = accept(listen_fds[i], NULL, NULL);
+        if (fd < 0)
+        {
+            printf("Accept Error: %d %s\n", errno, strerror(errno));
+            assert(false);
+        }
+        close(listen_fds[i]);
+        set_nodelay(fd);
+        UringConn *conn = new UringConn;
+        conn->fd = fd;
+        conns.push_back(conn);
+    }
+    listen_fds.clear();
+}
+
+// Buffers and receives are set up by the input thread that owns the ring.
+void UringReceiver::arm()
+{
+    bufs = (char *)mem_allocator.align_alloc(URING_RECV_BUF * URING_RECV_BUF_CNT);
+    provide(0, URING_RECV_BUF_CNT);
+    for (uint64_t i = 0; i < conns.size(); i++)
+        arm_recv(i);
+    ring.submit();
+    armed = true;
+}
+
+void UringReceiver::arm_recv(uint64_t conn_idx)
+{
+    struct io_uring_sqe *sqe;
+    while ((sqe = ring.get_sqe()) == NULL)
+        ring.submit();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conns[conn_idx]->fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = conn_idx;
+}
+
+void UringReceiver::provide(uint64_t bid, uint64_t cnt)
+{
+    struct io_uring_sqe *sqe;
+    while ((sqe = ring.get_sqe()) == NULL)
+        ring.submit();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = cnt;
+    sqe->addr = (uint64_t)(bufs + bid * URING_RECV_BUF);
+    sqe->len = URING_RECV_BUF;
+    sqe->off = bid;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = URING_PROVIDE_TAG;
+}
+
+void UringReceiver::reap()
+{
+    struct io_uring_cqe *cqe;
+    while ((cqe = ring.peek_cqe()) != NULL)
+    {
+        uint64_t tag = cqe->user_data;
+        int res = cqe->res;
+        uint32_t flags = cqe->flags;
+        ring.cqe_seen();
+        if (tag == URING_PROVIDE_TAG)
+        {
+            assert(res >= 0);
+            continue;
+        }
+
+        UringConn *conn = conns[tag];
+        if (conn->closed)
+        {
+            // Dropped for a bad frame; its data is thrown away.
+            if (res > 0)
+                provide(flags >> IORING_CQE_BUFFER_SHIFT, 1);
+            continue;
+        }
+        if (res > 0)
+        {
+            assert(flags & IORING_CQE_F_BUFFER);
+            uint64_t bid = flags >> IORING_CQE_BUFFER_SHIFT;
+            char *data = bufs + bid * URING_RECV_BUF;
+            conn->rbuf.insert(conn->rbuf.end(), data, data + res);
+            provide(bid, 1);
+        }
+        else if (res != -ENOBUFS)
+        {
+            // Peer is gone; its frames still buffered are handed out.
+            conn->closed = true;
+            continue;
+        }
+        if (!(flags & IORING_CQE_F_MORE))
+            arm_recv(tag);
+    }
+}
+
+char *UringReceiver::find_frame(uint64_t &size, UringConn *&conn)
+{
+    for (uint64_t i = 0; i < conns.size(); i++)
+    {
+        UringConn *c = conns[(next + i) % conns.size()];
+        uint64_t avail = c->rbuf.size() - c->roff;
+        if (avail < sizeof(uint32_t))
+            continue;
+        uint32_t len;
+        memcpy(&len, &c->rbuf[c->roff], sizeof(len));
+        if (len > URING_FRAME_MAX)
+        {
+            // No frame is that long, so the peer is not to be trusted.
+            assert(0);
+            drop_conn(c);
+            continue;
+        }
+        if (avail < sizeof(len) + len)
+            continue;
+        next = (next + i + 1) % conns.size();
+        size = len;
+        conn = c;
+        return &c->rbuf[c->roff + sizeof(len)];
+    }
+    return NULL;
+}
+
+void UringReceiver::drop_conn(UringConn *conn)
+{
+    conn->closed = true;
+    conn->rbuf.clear();
+    conn->rbuf.shrink_to_fit();
+    conn->roff = 0;
+    ::shutdown(conn->fd, SHUT_RDWR);
+}
+
+char *UringReceiver::next_frame(uint64_t &size, UringConn *&conn, uint64_t wait)
+{
+    if (!armed)
+        arm();
+    char *buf = find_frame(size, conn);
+    if (buf)
+        return buf;
+    reap();
+    ring.submit();
+    buf = find_frame(size, conn);
+    if (buf || wait == 0)
+        return buf;
+    // Sleep in the kernel until some connection delivers.
+    ring.submit(1, wait);
+    reap();
+    ring.submit();
+    return find_frame(size, conn);
+}
+
+void UringReceiver::consume(UringConn *conn, uint64_t size)
+{
+    conn->roff += sizeof(uint32_t) + size;
+    if (conn->roff == conn->rbuf.size())
+    {
+        conn->rbuf.clear();
+        conn->roff = 0;
+    }
+    else if (conn->roff >= URING_RECV_BUF)
+    {
+        conn->rbuf.erase(conn->rbuf.begin(), conn->rbuf.begin() + conn->roff);
+        conn->roff = 0;
+    }
+}
+#endif
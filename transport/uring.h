@@ -0,0 +1,106 @@
+#ifndef _URING_H_
+#define _URING_H_
+
+#include "global.h"
+
+#if IO_URING_TRANSPORT
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+
+/*
+    Minimal io_uring wrapper on the raw system calls, as liburing is not among
+    the dependencies. A ring is driven by a single thread.
+*/
+class URing
+{
+public:
+    ~URing() { close(); }
+    bool init(unsigned entries);
+    void close();
+
+    // Next free submission entry, zeroed, or NULL if the queue is full.
+    struct io_uring_sqe *get_sqe();
+    // Hands queued entries to the kernel. With wait_nr > 0, also waits up to
+    // timeout ns (0 for no limit) for that many completions.
+    int submit(unsigned wait_nr = 0, uint64_t timeout = 0);
+    bool has_pending() { return to_submit > 0; }
+
+    struct io_uring_cqe *peek_cqe();
+    void cqe_seen();
+
+    // Number of io_uring_enter calls made, for the stats.
+    uint64_t enter_cnt = 0;
+
+private:
+    int fd = -1;
+    void *sq_ptr = NULL;
+    void *cq_ptr = NULL;
+    size_t sq_len = 0;
+    size_t cq_len = 0;
+    struct io_uring_sqe *sqes = NULL;
+    size_t sqes_len = 0;
+
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_array;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    unsigned sqe_tail = 0;
+    unsigned to_submit = 0;
+};
+
+// A TCP connection read by an input thread, with the bytes not yet parsed.
+struct UringConn
+{
+    int fd = -1;
+    bool closed = false;
+    std::vector<char> rbuf;
+    uint64_t roff = 0;
+};
+
+/*
+    Receive side of one input thread. Each connection has a multishot recv
+    that picks buffers from a group provided to the kernel once; data is
+    copied out into the connection so that frames, sent as [uint32 len][frame],
+    can straddle buffers, and the buffer is handed back right away.
+*/
+class UringReceiver
+{
+public:
+    ~UringReceiver();
+    void add_listener(int fd) { listen_fds.push_back(fd); }
+    void accept_all();
+    bool empty() { return conns.empty(); }
+
+    // Returns the next complete frame in place, or NULL once nothing arrives
+    // within wait ns. consume() releases it.
+    char *next_frame(uint64_t &size, UringConn *&conn, uint64_t wait);
+    void consume(UringConn *conn, uint64_t size);
+
+    URing ring;
+
+private:
+    void arm();
+    void arm_recv(uint64_t conn_idx);
+    void provide(uint64_t bid, uint64_t cnt);
+    void reap();
+    char *find_frame(uint64_t &size, UringConn *&conn);
+    void drop_conn(UringConn *conn);
+
+    bool armed = false;
+    char *bufs = NULL;
+    uint64_t next = 0;
+    std::vector<int> listen_fds;
+    std::vector<UringConn *> conns;
+};
+
+int uring_listen(const char *addr, uint64_t port_id);
+int uring_connect(const char *src_addr, const char *dest_addr, uint64_t port_id);
+#endif
+
+#endif